@@ -8,7 +8,7 @@
  *
  * 原理说明：
  * 1. 频率分析：使用 Goertzel 算法检测 450Hz 信号（中国/北美标准）
- * 2. 时序分析：根据响/停时长模式区分不同信号
+ * 2. 时序分析：根据响/停时长模式区分不同信号 (规则见 ringback.conf.xml)
  *    - 忙音：响 350ms，停 350ms
  *    - 回铃音：响 1000ms，停 4000ms
  *    - 拥塞音：响 700ms，停 700ms
@@ -20,232 +20,889 @@
 #include <string.h>
 #include <stdlib.h>
 
-/* 信号音类型定义 (兼容 mod_da2) */
-#define RINGBACK_TONE_BUSY           0x01
-#define RINGBACK_TONE_RINGBACK       0x02
-#define RINGBACK_TONE_COLORRINGBACK  0x04
-#define RINGBACK_TONE_SILENCE        0x20
-#define RINGBACK_TONE_450HZ          0x40
+#include "ringback_dsp.h"
+#include "ringback_cadence.h"
+#include "ringback_tones.h"
+#include "ringback_prefix.h"
+#include "ringback_timer.h"
+#include "ringback_ring.h"
+#include "ringback_stats.h"
+#include "ringback_probes.h"
+#include "ringback_trace.h"
+#include "ringback_detector.h"
 
-/* 采样率 */
-#define SAMPLE_RATE 8000
+/* 分析采样率：宽带输入先抽取到此采样率 (块长、滤波器组频点见 ringback_detector.h) */
+#define SAMPLE_RATE RINGBACK_DETECTOR_RATE
 
-/* Goertzel 算法参数 - 检测 450Hz */
-#define TARGET_FREQ 450.0
-#define GOERTZEL_N 205  /* 约 25.6ms @ 8kHz, 适合检测 450Hz */
+#define DEFAULT_MAX_DETECT_TIME 60  /* 秒 */
+#define DEFAULT_CONFIDENCE 0.9      /* 早判后验概率阈值，0 关闭 */
+#define DEFAULT_MONITOR_INTERVAL 5  /* 判定后每 5 帧 (100ms) 检查一次，0 关闭监视 */
+#define DEFAULT_TRACE_SECONDS 0     /* 跟踪缓冲保存的时长，默认关闭 (配置或通道变量开启) */
 
-/* 时序规则 (毫秒) - 允许误差 */
-#define BUSY_ON_MIN      250
-#define BUSY_ON_MAX      450
-#define BUSY_OFF_MIN     250
-#define BUSY_OFF_MAX     450
+/* 配置快照读者计数分片数，按通道地址散列，避免所有媒体线程争用同一缓存行 */
+#define PROFILE_READER_SHARDS 64
 
-#define RINGBACK_ON_MIN  900
-#define RINGBACK_ON_MAX  1200
-#define RINGBACK_OFF_MIN 3000
-#define RINGBACK_OFF_MAX 5000
+/* 跨通道批处理引擎 (通道变量 ringback_batch=true 启用) */
+#define BATCH_CAPACITY   2048   /* 槽位数 */
+#define BATCH_TICK_US    20000  /* 每 20ms 统一计算一轮 */
+#define BATCH_IDLE_TICKS 250    /* 5 秒无数据的槽位视为通道已消失 */
 
-#define CONGESTION_ON_MIN  600
-#define CONGESTION_ON_MAX  800
-#define CONGESTION_OFF_MIN 500
-#define CONGESTION_OFF_MAX 900
+/* 卸载模式 (配置 workers > 0)：媒体回调只拷帧，工作线程分析 */
+#define OFFLOAD_MAX_WORKERS 64
+#define OFFLOAD_MAX_JOBS    16384   /* 同时卸载的通道数上限，超出的通道在媒体线程分析 */
 
-/* 能量阈值 */
-#define ENERGY_THRESHOLD 500
-#define MIN_TONE_SAMPLES 80  /* 10ms @ 8kHz */
+/* 时间轮节拍；一拍内到期的截止时刻最多批量处理这么多个，其余顺延一拍 */
+#define WHEEL_TICK_US     10000
+#define WHEEL_MAX_EXPIRED 256
+
+/* 通道私有数据键，接通/桥接/挂机/超时回调据此找到检测状态 */
+#define RINGBACK_PRIVATE "_ringback_state_"
+/* 检测结束后仍保留，uuid_ringback_trace 据此找到最近一次检测 (状态在会话内存池中，随会话释放) */
+#define RINGBACK_TRACE_PRIVATE "_ringback_trace_"
+
+/*
+ * 卸载任务：一个通道的帧队列。任务对象只增不减 (释放后挂回空闲链表复用，模块卸载时才 free)，
+ * 工作线程扫描任务表时不会碰到已释放的内存。
+ * busy 保证同一时刻只有一个线程消费队列：0 空闲，1 工作线程处理中，2 正在释放
+ */
+typedef struct ringback_job {
+    volatile int32_t busy;
+    volatile int32_t queued;        /* 在就绪链表中或正被工作线程处理 */
+    int owner;                      /* 归属工作线程 */
+    struct ringback_state *state;   /* NULL 表示空闲 */
+    struct ringback_job *next_free;
+    struct ringback_job *next_ready;
+    ringback_ring_t ring;
+} ringback_job_t;
 
 /* 检测状态 */
 typedef struct ringback_state {
     switch_core_session_t *session;
     switch_media_bug_t *bug;
     int running;
-    int sample_count;
-    double goertzel_s1, goertzel_s2;
-    double goertzel_coef;
-    int in_tone;
-    uint32_t tone_start_ms;
-    uint32_t silence_start_ms;
-    uint32_t last_tone_duration_ms;
-    uint32_t last_silence_duration_ms;
-    int tone_type;
-    int consecutive_busy;
-    int consecutive_ringback;
-    uint32_t start_time_ms;
+    ringback_detector_t det;    /* 分析链路、时序跟踪、监视和判定跟踪 */
+    char rule_name[RINGBACK_CADENCE_NAME_LEN];  /* 最近匹配的规则 */
+    int finish_on_tone;         /* 因命中 stoptone 而停止 */
+    const char *finish_cause;   /* 非信号音停止的原因 (answer/bridge/hangup)，NULL 表示超时 */
+    int detached;               /* 已从通道摘除 (只摘除一次) */
+    ringback_timer_t deadline;  /* 最大检测时间，挂在全局时间轮上 */
+    const char *profiles;       /* 通道指定的候选方案 (ringback_profiles)，NULL 表示配置默认 */
+    uint32_t generation;        /* det 中规则所属的配置快照版本 */
+    const char *destination;    /* 被叫号码，按前缀选择路由 */
+    const char *gateway;        /* 网关名，前缀未命中时的回退 */
+    const char *result_variable;
     uint32_t max_detect_time_ms;
     int autohangup;
-    char *stoptone;
-    int hangup_on_busy;
-    int hangup_on_ringback;
+    int batch_slot;             /* 批处理槽位，-1 表示逐通道计算 */
+    ringback_job_t *job;        /* 卸载任务，NULL 表示在媒体线程分析 */
+    int trace_on_unknown;       /* 结果为 unknown 时把跟踪写入通道变量 ringback_trace */
+    struct ringback_state *prev_attached, *next_attached;  /* 已挂状态回调的通道链表，模块卸载时逐个清理 */
 } ringback_state_t;
 
-/* Goertzel 系数预计算 */
-static double goertzel_coefficient = 0;
+static struct {
+    switch_memory_pool_t *pool;
+    switch_mutex_t *mutex;          /* 保护批处理引擎的写入/切换/发布 */
+    ringback_batch_t *batch;
+    switch_thread_t *batch_thread;
+    volatile int batch_running;
+
+    /* 卸载工作线程池，首个卸载通道到来时按当时配置创建 */
+    switch_mutex_t *offload_mutex;  /* 保护任务分配/释放 */
+    ringback_job_t **jobs;
+    volatile int32_t njobs;
+    ringback_job_t *free_jobs;
+    switch_thread_t *workers[OFFLOAD_MAX_WORKERS];
+    int nworkers;
+    int worker_cpus[OFFLOAD_MAX_WORKERS];
+    int nworker_cpus;
+    volatile int offload_running;
+    switch_mutex_t *ready_mutex;    /* 保护各线程的就绪链表和休眠标志 */
+    struct {
+        switch_thread_cond_t *cond;
+        ringback_job_t *head, *tail;
+        int waiting;
+    } ready[OFFLOAD_MAX_WORKERS];
+    uint64_t offload_drops;         /* 队列满丢弃的帧 */
+    uint64_t offload_steals;        /* 由非归属线程处理的批次 */
+
+    /* ringback.conf.xml 编译后的当前快照，reload 时原子替换 */
+    struct ringback_profile *profile;
+    switch_mutex_t *reload_mutex;   /* 串行化 reload，只在控制线程使用 */
+    switch_event_node_t *reload_node;
+    switch_event_node_t *answer_node;
+    switch_event_node_t *bridge_node;
+
+    /* 所有通道的截止时刻，由 wheel_thread 按 WHEEL_TICK_US 推进 */
+    switch_mutex_t *wheel_mutex;
+    ringback_wheel_t wheel;
+    switch_time_t wheel_epoch;
+    switch_thread_t *wheel_thread;
+    volatile int wheel_running;
+    int nexpired;                   /* 本拍到期的通道，只在 wheel_thread 中访问 */
+    char expired[WHEEL_MAX_EXPIRED][SWITCH_UUID_FORMATTED_LENGTH + 1];
+    struct {
+        volatile int32_t n;
+        char pad[64 - sizeof(int32_t)];
+    } readers[PROFILE_READER_SHARDS];
+
+    int32_t active;                 /* 正在检测的通道数 */
 
-static void init_goertzel(void)
+    /*
+     * 挂过检测的通道 (状态回调表在本模块内，直到通道销毁)；
+     * 卸载开始后拒绝新的挂接，并等待挂接中的通道完成
+     */
+    switch_mutex_t *attach_mutex;
+    ringback_state_t *attached;
+    int attaching;
+    int shutting_down;
+
+    /* 按 CPU 分片的计数器和延迟直方图 (ringback_stats API) */
+    ringback_stats_t stats;
+
+    /* 监视模式：当前通道数和回到完整分析的次数 */
+    int32_t monitoring;
+    uint64_t monitor_resumes;
+} globals;
+
+/*
+ * USDT 探针 (provider ringback)，参数依次为：
+ *   attach  (uuid, 输入采样率, maxdetecttime ms, 是否卸载)
+ *   frame   (uuid, 样本数, 载荷字节数, 回调耗时 ns, 是否卸载)
+ *   edge    (uuid, 频率特征下标, 1 起音/0 停音, 边沿时刻 ms, 刚结束的段时长 ms, 本块 RMS)，
+ *           在 ringback_detector.c 中定义
+ *   match   (uuid, 规则名, 信号类型, 命中时刻 ms, 置信度 x1000)
+ *   verdict (uuid, 信号类型, 结束原因, 判定时延 ms, 规则名)
+ */
+RINGBACK_PROBE_SEMAPHORE(attach);
+RINGBACK_PROBE_SEMAPHORE(frame);
+RINGBACK_PROBE_SEMAPHORE(match);
+RINGBACK_PROBE_SEMAPHORE(verdict);
+
+/*
+ * 配置快照：加载后只读。媒体回调只在单次回调内使用快照 (不跨帧持有指针)，
+ * 进出时在所属分片的读者计数上加减；reload 发布新快照后，逐个分片观察到
+ * 计数归零即说明换指针前进入的回调都已退出，旧快照可以释放。
+ * 读端无锁、无等待，写端 (控制线程) 只需短暂等待在途回调
+ */
+/* 按被叫前缀或网关选择的呼叫参数，routes[0] 为 settings 中的默认值 */
+typedef struct ringback_route {
+    uint64_t rules;             /* 候选方案对应的规则位图 */
+    int energy_threshold;
+    uint32_t max_detect_time_ms;
+    int stoptones;
+    int autohangup;
+} ringback_route_t;
+
+typedef struct ringback_gateway_route {
+    char name[64];
+    int route;
+} ringback_gateway_route_t;
+
+typedef struct ringback_profile {
+    uint32_t generation;
+    char result_variable[64];
+    int nroutes;
+    ringback_route_t *routes;
+    ringback_prefix_t prefixes;             /* 被叫前缀 -> routes 下标 */
+    int ngateways;
+    ringback_gateway_route_t *gateways;
+    int monitor_interval;                   /* 判定后监视的检查间隔 (帧)，0 关闭监视 */
+    int trace_seconds;                      /* 每通道跟踪缓冲时长，0 关闭 */
+    int trace_on_unknown;
+    int workers;                            /* 卸载工作线程数，0 在媒体线程分析 */
+    int nworker_cpus;
+    int worker_cpus[OFFLOAD_MAX_WORKERS];   /* 工作线程依次绑定的 CPU */
+    ringback_toneset_t tones;
+} ringback_profile_t;
+
+static void profile_free(ringback_profile_t *profile)
 {
-    if (goertzel_coefficient == 0) {
-        double k = (double)GOERTZEL_N * TARGET_FREQ / SAMPLE_RATE;
-        goertzel_coefficient = 2.0 * cos(2.0 * M_PI * k / GOERTZEL_N);
+    if (profile) {
+        ringback_prefix_destroy(&profile->prefixes);
+        free(profile->routes);
+        free(profile->gateways);
+        free(profile);
     }
 }
 
-/* Goertzel 算法 - 处理一个样本 */
-static void goertzel_process_sample(ringback_state_t *state, int16_t sample)
+/* 被叫号码最长前缀匹配，未命中按网关名回退，再回退到默认参数 */
+static const ringback_route_t *route_lookup(const ringback_profile_t *profile, const char *destination,
+                                            const char *gateway)
 {
-    double s0 = (double)sample + state->goertzel_coef * state->goertzel_s1 - state->goertzel_s2;
-    state->goertzel_s2 = state->goertzel_s1;
-    state->goertzel_s1 = s0;
-    state->sample_count++;
+    int i, r = ringback_prefix_lookup(&profile->prefixes, destination);
+
+    if (r < 0 && !zstr(gateway)) {
+        for (i = 0; i < profile->ngateways; i++) {
+            if (!strcasecmp(profile->gateways[i].name, gateway)) {
+                r = profile->gateways[i].route;
+                break;
+            }
+        }
+    }
+
+    return &profile->routes[r < 0 ? 0 : r];
 }
 
-/* 获取 Goertzel 能量 */
-static double goertzel_get_energy(ringback_state_t *state)
+static inline int profile_shard(const void *owner)
 {
-    double power = state->goertzel_s1 * state->goertzel_s1 + state->goertzel_s2 * state->goertzel_s2
-                   - state->goertzel_coef * state->goertzel_s1 * state->goertzel_s2;
-    return power / (GOERTZEL_N * GOERTZEL_N);
+    return (int)(((uintptr_t)owner >> 6) % PROFILE_READER_SHARDS);
 }
 
-/* 计算帧能量 (RMS) */
-static double calc_frame_energy(int16_t *samples, int count)
+/* 进入读端，返回当前快照；必须与 profile_exit 配对 */
+static inline const ringback_profile_t *profile_enter(int shard)
+{
+    __atomic_add_fetch(&globals.readers[shard].n, 1, __ATOMIC_SEQ_CST);
+    return __atomic_load_n(&globals.profile, __ATOMIC_SEQ_CST);
+}
+
+static inline void profile_exit(int shard)
+{
+    __atomic_sub_fetch(&globals.readers[shard].n, 1, __ATOMIC_RELEASE);
+}
+
+/* 发布新快照并回收旧快照 (调用方持有 reload_mutex) */
+static void profile_publish(ringback_profile_t *profile)
+{
+    ringback_profile_t *old = __atomic_exchange_n(&globals.profile, profile, __ATOMIC_SEQ_CST);
+    int i;
+
+    if (!old) {
+        return;
+    }
+    for (i = 0; i < PROFILE_READER_SHARDS; i++) {
+        while (__atomic_load_n(&globals.readers[i].n, __ATOMIC_ACQUIRE) != 0) {
+            switch_yield(100);
+        }
+    }
+    profile_free(old);
+}
+
+/* 信号类型名称及自动挂断原因 */
+static const struct {
+    const char *name;
+    int tone;
+    switch_call_cause_t cause;
+} tone_names[] = {
+    { "busy", RINGBACK_TONE_BUSY, SWITCH_CAUSE_USER_BUSY },
+    { "ringback", RINGBACK_TONE_RINGBACK, SWITCH_CAUSE_NO_ANSWER },
+    { "congestion", RINGBACK_TONE_CONGESTION, SWITCH_CAUSE_NORMAL_CIRCUIT_CONGESTION },
+};
+#define TONE_NAMES ((int)(sizeof(tone_names) / sizeof(tone_names[0])))
+
+static int tone_from_name(const char *name)
+{
+    int i;
+    for (i = 0; i < TONE_NAMES; i++) {
+        if (!strcasecmp(name, tone_names[i].name)) {
+            return tone_names[i].tone;
+        }
+    }
+    return 0;
+}
+
+static const char *tone_to_name(int tone)
 {
-    double sum = 0;
     int i;
-    for (i = 0; i < count; i++) {
-        sum += (double)samples[i] * samples[i];
+    for (i = 0; i < TONE_NAMES; i++) {
+        if (tone_names[i].tone == tone) {
+            return tone_names[i].name;
+        }
+    }
+    return "unknown";
+}
+
+/* "busy,congestion" / "all" -> RINGBACK_TONE_* 位 */
+static int parse_stoptones(const char *value)
+{
+    char buf[128], *tok, *save = NULL;
+    int mask = 0;
+
+    switch_copy_string(buf, value, sizeof(buf));
+    for (tok = strtok_r(buf, ", ", &save); tok; tok = strtok_r(NULL, ", ", &save)) {
+        if (!strcasecmp(tok, "all")) {
+            mask |= RINGBACK_TONE_BUSY | RINGBACK_TONE_RINGBACK | RINGBACK_TONE_CONGESTION;
+        } else {
+            mask |= tone_from_name(tok);
+        }
+    }
+    return mask;
+}
+
+/* 滤波器组模板，加载时计算一次系数，每路通道直接拷贝 */
+static ringback_bank_t bank_template;
+
+static void set_ringback_result(ringback_state_t *state);
+static switch_status_t reload_profile(void);
+static void offload_ready(ringback_job_t *job);
+static void offload_reclaim(ringback_state_t *state);
+
+/* 批处理线程：切换暂存区后在锁外计算，结果发布后各通道在下一帧取用 */
+static void *SWITCH_THREAD_FUNC batch_thread_run(switch_thread_t *thread, void *obj)
+{
+    while (globals.batch_running) {
+        switch_yield(BATCH_TICK_US);
+
+        switch_mutex_lock(globals.mutex);
+        ringback_batch_swap(globals.batch);
+        switch_mutex_unlock(globals.mutex);
+
+        ringback_batch_run(globals.batch);
+
+        switch_mutex_lock(globals.mutex);
+        ringback_batch_publish(globals.batch);
+        ringback_batch_reap(globals.batch, BATCH_IDLE_TICKS);
+        switch_mutex_unlock(globals.mutex);
+    }
+    return NULL;
+}
+
+/* 首个批处理通道到来时创建引擎和线程 */
+static switch_status_t batch_engine_start(void)
+{
+    switch_threadattr_t *thd_attr = NULL;
+    switch_status_t status = SWITCH_STATUS_SUCCESS;
+
+    switch_mutex_lock(globals.mutex);
+    if (!globals.batch) {
+        globals.batch = ringback_batch_create(BATCH_CAPACITY, ringback_default_freqs, RINGBACK_DEFAULT_NBINS, SAMPLE_RATE);
+        if (!globals.batch) {
+            status = SWITCH_STATUS_GENERR;
+        } else {
+            globals.batch_running = 1;
+            switch_threadattr_create(&thd_attr, globals.pool);
+            switch_threadattr_stacksize_set(thd_attr, SWITCH_THREAD_STACKSIZE);
+            switch_thread_create(&globals.batch_thread, thd_attr, batch_thread_run, NULL, globals.pool);
+        }
+    }
+    switch_mutex_unlock(globals.mutex);
+
+    return status;
+}
+
+static void release_batch_slot(ringback_state_t *state)
+{
+    if (state->batch_slot >= 0) {
+        switch_mutex_lock(globals.mutex);
+        if (ringback_batch_owner(globals.batch, state->batch_slot) == state) {
+            ringback_batch_release(globals.batch, state->batch_slot);
+        }
+        switch_mutex_unlock(globals.mutex);
+        state->batch_slot = -1;
+        state->det.block_fn = NULL;
     }
-    return sqrt(sum / count);
 }
 
-/* 检查是否匹配忙音模式 */
-static int match_busy_pattern(uint32_t on_ms, uint32_t off_ms)
+static inline uint64_t wheel_ticks_now(void)
 {
-    return (on_ms >= BUSY_ON_MIN && on_ms <= BUSY_ON_MAX &&
-            off_ms >= BUSY_OFF_MIN && off_ms <= BUSY_OFF_MAX);
+    return (uint64_t)(switch_micro_time_now() - globals.wheel_epoch) / WHEEL_TICK_US;
 }
 
-/* 检查是否匹配回铃音模式 */
-static int match_ringback_pattern(uint32_t on_ms, uint32_t off_ms)
+/* ms 毫秒后到期 (向上取整到节拍) */
+static void wheel_arm(ringback_timer_t *t, uint32_t ms)
 {
-    return (on_ms >= RINGBACK_ON_MIN && on_ms <= RINGBACK_ON_MAX &&
-            off_ms >= RINGBACK_OFF_MIN && off_ms <= RINGBACK_OFF_MAX);
+    switch_mutex_lock(globals.wheel_mutex);
+    ringback_wheel_add(&globals.wheel, t, wheel_ticks_now() + ((uint64_t)ms * 1000 + WHEEL_TICK_US - 1) / WHEEL_TICK_US);
+    switch_mutex_unlock(globals.wheel_mutex);
+}
+
+static void wheel_cancel(ringback_timer_t *t)
+{
+    if (ringback_timer_pending(t)) {
+        switch_mutex_lock(globals.wheel_mutex);
+        ringback_wheel_cancel(&globals.wheel, t);
+        switch_mutex_unlock(globals.wheel_mutex);
+    }
+}
+
+/* 停止检测并写入结果 */
+static void stop_ringback(ringback_state_t *state)
+{
+    state->running = 0;
+    __atomic_sub_fetch(&globals.active, 1, __ATOMIC_RELAXED);
+    ringback_stats_inc(&globals.stats, ringback_stats_shard(), RINGBACK_STAT_STOPPED);
+    wheel_cancel(&state->deadline);
+    if (state->det.monitor.active) {
+        state->det.monitor.active = 0;
+        __atomic_sub_fetch(&globals.monitoring, 1, __ATOMIC_RELAXED);
+    }
+    release_batch_slot(state);
+    set_ringback_result(state);
+}
+
+/*
+ * 批处理引擎算块：写入槽位，取走已算完的结果 (至少延迟一轮)。
+ * 帧长大于计算周期时两帧之间有空轮，结果在槽位队列中保留到这里取走。
+ * 槽位因长时间无数据被回收时重新分配，分配不到就改回逐通道计算
+ */
+static int batch_blocks(void *arg, const int16_t *samples, int count, ringback_block_t *out)
+{
+    ringback_state_t *state = (ringback_state_t *)arg;
+    ringback_batch_result_t r[RINGBACK_BATCH_PENDING];
+    int nblocks = 0, i;
+
+    switch_mutex_lock(globals.mutex);
+    if (ringback_batch_owner(globals.batch, state->batch_slot) != state) {
+        state->batch_slot = ringback_batch_acquire(globals.batch, state);
+    }
+    if (state->batch_slot >= 0) {
+        ringback_batch_push(globals.batch, state->batch_slot, samples, count);
+        nblocks = ringback_batch_take(globals.batch, state->batch_slot, r, RINGBACK_BATCH_PENDING);
+    } else {
+        state->det.block_fn = NULL;
+    }
+    switch_mutex_unlock(globals.mutex);
+
+    /* 一轮结果即一个块 */
+    for (i = 0; i < nblocks; i++) {
+        out[i].sumsq = r[i].sumsq;
+        out[i].count = r[i].count;
+        memcpy(out[i].power, r[i].power, sizeof(out[i].power));
+        out[i].env_n = 0;
+    }
+    return nblocks;
+}
+
+/*
+ * 处理检测器给出的一条判定：统计、探针、日志，属于 stoptone 时停止检测
+ * (并按配置挂断)，返回 SWITCH_FALSE
+ */
+static switch_bool_t verdict_reached(ringback_state_t *state, const ringback_profile_t *profile,
+                                     const ringback_verdict_t *v)
+{
+    const ringback_cadence_rule_t *rule = &profile->tones.rules[v->rule];
+    int shard = ringback_stats_shard();
+
+    switch_copy_string(state->rule_name, rule->name, sizeof(state->rule_name));
+    if (v->first) {
+        ringback_hist_add(&globals.stats.shard[shard].verdict_ms, state->det.decision_ms);
+        if (v->confidence < 1.0f) {
+            ringback_stats_inc(&globals.stats, shard, RINGBACK_STAT_EARLY);
+        }
+    }
+    ringback_stats_inc(&globals.stats, shard, v->tone == RINGBACK_TONE_BUSY ? RINGBACK_STAT_VERDICT_BUSY :
+                                              v->tone == RINGBACK_TONE_RINGBACK ? RINGBACK_STAT_VERDICT_RINGBACK :
+                                              v->tone == RINGBACK_TONE_CONGESTION ? RINGBACK_STAT_VERDICT_CONGESTION :
+                                              RINGBACK_STAT_VERDICT_OTHER);
+    RINGBACK_PROBE5(match, switch_core_session_get_uuid(state->session), rule->name, tone_to_name(v->tone), v->ms,
+                    (int)(v->confidence * 1000.0f));
+    switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(state->session), SWITCH_LOG_DEBUG,
+                      "mod_ringback: matched rule %s (%s) at %u ms, confidence %.3f\n", rule->name,
+                      tone_to_name(v->tone), v->ms, v->confidence);
+
+    if (!v->stop) {
+        return SWITCH_TRUE;
+    }
+
+    state->finish_on_tone = 1;
+    stop_ringback(state);
+    if (state->autohangup) {
+        int i;
+        for (i = 0; i < TONE_NAMES; i++) {
+            if (tone_names[i].tone == v->tone) {
+                switch_channel_hangup(switch_core_session_get_channel(state->session), tone_names[i].cause);
+                ringback_stats_inc(&globals.stats, shard, RINGBACK_STAT_HANGUPS);
+                break;
+            }
+        }
+    }
+    return SWITCH_FALSE;
+}
+
+/* 分析一帧，profile 为本次回调取到的配置快照 */
+static switch_bool_t analyze_frame(ringback_state_t *state, const ringback_profile_t *profile,
+                                   const ringback_detector_frame_t *frame)
+{
+    ringback_detector_t *det = &state->det;
+    ringback_verdict_t v;
+    int monitoring = det->monitor.active, ret;
+
+    /* 配置已重新加载：规则表可能变化，按新快照重新选择规则，时序状态从头匹配 */
+    if (state->generation != profile->generation) {
+        const ringback_route_t *route = route_lookup(profile, state->destination, state->gateway);
+        state->generation = profile->generation;
+        det->monitor_interval = profile->monitor_interval;
+        ringback_detector_set_rules(det, state->profiles ? ringback_toneset_select(&profile->tones, state->profiles)
+                                                         : route->rules, route->energy_threshold);
+    }
+
+    ret = ringback_detector_feed(det, &profile->tones, frame);
+
+    /* 判定后进入监视，或信号变化回到完整分析 */
+    if (det->monitor.active != monitoring) {
+        if (det->monitor.active) {
+            __atomic_add_fetch(&globals.monitoring, 1, __ATOMIC_RELAXED);
+        } else {
+            __atomic_sub_fetch(&globals.monitoring, 1, __ATOMIC_RELAXED);
+            __atomic_add_fetch(&globals.monitor_resumes, 1, __ATOMIC_RELAXED);
+            switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(state->session), SWITCH_LOG_DEBUG,
+                              "mod_ringback: signal changed at %u ms, resuming full analysis\n",
+                              ringback_detector_ms(det));
+        }
+    }
+
+    if (ret == RINGBACK_DETECT_CONTINUE) {
+        return SWITCH_TRUE;
+    }
+    while (ringback_detector_poll(det, &v)) {
+        if (!verdict_reached(state, profile, &v)) {
+            return SWITCH_FALSE;
+        }
+    }
+    return SWITCH_TRUE;
 }
 
-/* 检查是否匹配拥塞音模式 */
-static int match_congestion_pattern(uint32_t on_ms, uint32_t off_ms)
+/* 处理媒体 bug 取到的一帧 */
+static switch_bool_t process_frame(ringback_state_t *state, const switch_frame_t *frame)
 {
-    return (on_ms >= CONGESTION_ON_MIN && on_ms <= CONGESTION_ON_MAX &&
-            off_ms >= CONGESTION_OFF_MIN && off_ms <= CONGESTION_OFF_MAX);
+    const ringback_profile_t *profile;
+    switch_bool_t ret = SWITCH_TRUE;
+    uint64_t t0, ns;
+    int shard, stat_shard;
+
+    /* CNG 帧可能不带载荷，仍需推进时钟 */
+    if ((!frame->data || frame->datalen == 0) && !(frame->flags & SFF_CNG)) {
+        return SWITCH_TRUE;
+    }
+
+    t0 = ringback_stats_clock(&stat_shard);
+
+    /* 卸载模式：媒体线程只拷贝帧，耗时统计只含拷贝；帧超过槽位时收回任务，改在本线程分析 */
+    if (state->job) {
+        int r = ringback_ring_push(&state->job->ring, frame->data, frame->data ? frame->datalen : 0, frame->samples,
+                                   frame->rate, frame->timestamp, frame->seq, frame->flags);
+        if (r == RINGBACK_RING_OK) {
+            offload_ready(state->job);
+        } else if (r == RINGBACK_RING_FULL) {
+            __atomic_add_fetch(&globals.offload_drops, 1, __ATOMIC_RELAXED);
+        } else if (r == RINGBACK_RING_TOO_LONG) {
+            switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(state->session), SWITCH_LOG_DEBUG,
+                              "mod_ringback: %u byte frame exceeds offload slot, analyzing in media thread\n",
+                              frame->datalen);
+            offload_reclaim(state);
+            ret = state->running ? SWITCH_TRUE : SWITCH_FALSE;
+        }
+    }
+    if (!state->job && state->running) {
+        ringback_detector_frame_t f = { frame->data, frame->datalen, frame->samples, frame->rate,
+                                        frame->timestamp, frame->seq, (frame->flags & SFF_CNG) != 0 };
+        shard = profile_shard(state);
+        profile = profile_enter(shard);
+        ret = analyze_frame(state, profile, &f);
+        profile_exit(shard);
+        ringback_stats_inc(&globals.stats, stat_shard, RINGBACK_STAT_FRAMES);
+    }
+
+    ns = ringback_stats_clock_ns(ringback_stats_clock(NULL) - t0);
+    ringback_hist_add(&globals.stats.shard[stat_shard].callback_ns, ns);
+    RINGBACK_PROBE5(frame, switch_core_session_get_uuid(state->session), frame->samples, frame->datalen, ns,
+                    state->job != NULL);
+    return ret;
 }
 
 /* 媒体 bug 回调 */
-static switch_bool_t ringback_media_callback(switch_media_bug_t *bug, void *user_data,
-                                             switch_abc_codec_t *codec,
-                                             void *buffer, switch_size_t len,
-                                             switch_frame_t *frame)
+static switch_bool_t ringback_media_callback(switch_media_bug_t *bug, void *user_data, switch_abc_type_t type)
 {
     ringback_state_t *state = (ringback_state_t *)user_data;
-    uint32_t now_ms;
-    int samples_per_frame;
-    int i;
 
-    if (!state || !state->running) {
+    if (!state) {
         return SWITCH_TRUE;
     }
 
-    if (!frame->data || frame->datalen == 0) {
-        return SWITCH_TRUE;
+    if (!state->running && (type == SWITCH_ABC_TYPE_READ || type == SWITCH_ABC_TYPE_TAP_NATIVE_READ)) {
+        /* 卸载模式下检测在工作线程结束，由媒体线程在下一帧摘除 bug */
+        return state->job ? SWITCH_FALSE : SWITCH_TRUE;
     }
 
-    /* 需要 L16 格式 (8kHz 16bit mono)，FreeSWITCH 内部通常已转换 */
-    samples_per_frame = frame->datalen / 2;
-    if (samples_per_frame <= 0) return SWITCH_TRUE;
+    switch (type) {
+    case SWITCH_ABC_TYPE_TAP_NATIVE_READ:
+        {
+            /* PCMU/PCMA 线路：解码前的原始载荷，带 RTP 序号/时间戳 */
+            switch_frame_t *frame = switch_core_media_bug_get_native_read_frame(bug);
 
-    now_ms = switch_micro_time_now() / 1000 - state->start_time_ms;
+            if (frame && !process_frame(state, frame)) {
+                return SWITCH_FALSE;
+            }
+        }
+        break;
+    case SWITCH_ABC_TYPE_READ:
+        {
+            uint8_t data[SWITCH_RECOMMENDED_BUFFER_SIZE];
+            switch_frame_t frame = { 0 };
 
-    /* 超时检测 */
-    if (state->max_detect_time_ms > 0 && now_ms > state->max_detect_time_ms) {
-        state->running = 0;
-        set_ringback_result(state);
-        return SWITCH_FALSE;
+            /* 取出读流中已解码的 L16 帧，不带 RTP 序号/时间戳 */
+            frame.data = data;
+            frame.buflen = sizeof(data);
+            while (state->running && switch_core_media_bug_read(bug, &frame, SWITCH_FALSE) == SWITCH_STATUS_SUCCESS) {
+                frame.seq = 0;
+                frame.timestamp = 0;
+                if (!process_frame(state, &frame)) {
+                    return SWITCH_FALSE;
+                }
+            }
+        }
+        break;
+    default:
+        break;
     }
+    return SWITCH_TRUE;
+}
 
-    init_goertzel();
-    state->goertzel_coef = goertzel_coefficient;
+/* 处理队列中全部帧，返回处理的帧数。调用方须已取得任务的消费权 */
+static int job_drain(ringback_job_t *job, ringback_state_t *state)
+{
+    const ringback_ring_frame_t *f;
+    int shard = profile_shard(state);
+    const ringback_profile_t *profile = profile_enter(shard);
+    int n = 0;
 
-    /* 处理音频帧 */
-    int16_t *samples = (int16_t *)frame->data;
-    double energy = calc_frame_energy(samples, samples_per_frame);
-    double goertzel_energy = 0;
+    while ((f = ringback_ring_peek(&job->ring))) {
+        if (state->running) {
+            ringback_detector_frame_t frame = { f->data, f->datalen, f->samples, f->rate,
+                                                f->timestamp, f->seq, (f->flags & SFF_CNG) != 0 };
+            analyze_frame(state, profile, &frame);
+        }
+        ringback_ring_pop(&job->ring);
+        n++;
+    }
+    profile_exit(shard);
+    __atomic_add_fetch(&globals.stats.shard[ringback_stats_shard()].counter[RINGBACK_STAT_FRAMES], n,
+                       __ATOMIC_RELAXED);
+    return n;
+}
+
+/* 取得任务的消费权后处理队列中全部帧，返回处理的帧数；任务忙或无帧返回 0 */
+static int job_run(ringback_job_t *job)
+{
+    ringback_state_t *state;
+    int32_t idle = 0;
+    int n = 0;
+
+    if (ringback_ring_empty(&job->ring) ||
+        !__atomic_compare_exchange_n(&job->busy, &idle, 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+        return 0;
+    }
+
+    if ((state = job->state)) {
+        n = job_drain(job, state);
+    }
 
-    /* 重置 Goertzel 状态每 GOERTZEL_N 样本 */
-    for (i = 0; i < samples_per_frame; i++) {
-        goertzel_process_sample(state, samples[i]);
-        if (state->sample_count >= GOERTZEL_N) {
-            goertzel_energy = goertzel_get_energy(state);
-            state->goertzel_s1 = state->goertzel_s2 = 0;
-            state->sample_count = 0;
+    __atomic_store_n(&job->busy, 0, __ATOMIC_RELEASE);
+    return n;
+}
+
+/*
+ * 通道队列由空变为非空时把任务挂到归属线程的就绪链表并唤醒它；归属线程正忙时
+ * 改为唤醒一个空闲线程来窃取。queued 在任务位于链表中或正被处理期间为 1，
+ * 任务同一时刻只在一处，已挂链时生产者不再加锁
+ */
+static void offload_ready(ringback_job_t *job)
+{
+    int i;
+
+    /* 与工作线程清除 queued 后复查队列配对，保证不丢唤醒 */
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_exchange_n(&job->queued, 1, __ATOMIC_SEQ_CST)) {
+        return;
+    }
+
+    switch_mutex_lock(globals.ready_mutex);
+    job->next_ready = NULL;
+    if (globals.ready[job->owner].tail) {
+        globals.ready[job->owner].tail->next_ready = job;
+    } else {
+        globals.ready[job->owner].head = job;
+    }
+    globals.ready[job->owner].tail = job;
+    for (i = 0; i < globals.nworkers; i++) {
+        int w = (job->owner + i) % globals.nworkers;
+        if (globals.ready[w].waiting) {
+            globals.ready[w].waiting = 0;
+            switch_thread_cond_signal(globals.ready[w].cond);
             break;
         }
     }
+    switch_mutex_unlock(globals.ready_mutex);
+}
 
-    /* 判断是否有 450Hz 信号 */
-    int has_tone = (energy > ENERGY_THRESHOLD) && (goertzel_energy > 1000 || state->sample_count > 0);
-    if (state->sample_count >= GOERTZEL_N / 2) {
-        goertzel_energy = goertzel_get_energy(state);
-        has_tone = has_tone || goertzel_energy > 1000;
+/* 取出线程 id 就绪链表的第一个任务，调用方持有 ready_mutex */
+static ringback_job_t *ready_pop(int id)
+{
+    ringback_job_t *job = globals.ready[id].head;
+
+    if (job && !(globals.ready[id].head = job->next_ready)) {
+        globals.ready[id].tail = NULL;
     }
+    return job;
+}
 
-    /* 简化：用能量判断 */
-    has_tone = (energy > ENERGY_THRESHOLD);
+/*
+ * 工作线程：先处理归属自己的就绪任务，没有时再取其他线程链表中的任务 (工作窃取)，
+ * 都没有才在条件变量上休眠，由 offload_ready 唤醒。突发集中在少数通道时空闲线程
+ * 会分担，不必等归属线程
+ */
+static void *SWITCH_THREAD_FUNC offload_worker_run(switch_thread_t *thread, void *obj)
+{
+    int id = (int)(intptr_t)obj;
+    ringback_job_t *job;
+    int i;
 
-    uint32_t frame_duration_ms = (samples_per_frame * 1000) / SAMPLE_RATE;
+    if (globals.nworker_cpus) {
+        switch_core_thread_set_cpu_affinity(globals.worker_cpus[id % globals.nworker_cpus]);
+    }
 
-    if (has_tone) {
-        if (!state->in_tone) {
-            state->in_tone = 1;
-            if (state->silence_start_ms > 0) {
-                state->last_silence_duration_ms = now_ms - state->silence_start_ms;
+    switch_mutex_lock(globals.ready_mutex);
+    while (globals.offload_running) {
+        if (!(job = ready_pop(id))) {
+            for (i = 1; i < globals.nworkers && !job; i++) {
+                job = ready_pop((id + i) % globals.nworkers);
+            }
+            if (job) {
+                __atomic_add_fetch(&globals.offload_steals, 1, __ATOMIC_RELAXED);
             }
-            state->tone_start_ms = now_ms;
         }
-    } else {
-        if (state->in_tone) {
-            state->in_tone = 0;
-            state->last_tone_duration_ms = now_ms - state->tone_start_ms;
-            state->silence_start_ms = now_ms;
-
-            /* 模式匹配 */
-            if (match_busy_pattern(state->last_tone_duration_ms, 0)) {
-                state->consecutive_busy++;
-                state->consecutive_ringback = 0;
-                if (state->consecutive_busy >= 2) {
-                    state->tone_type = RINGBACK_TONE_BUSY;
-                    state->running = 0;
-                    set_ringback_result(state);
-                    if (state->hangup_on_busy) {
-                        switch_channel_t *channel = switch_core_session_get_channel(state->session);
-                        switch_channel_hangup(channel, SWITCH_CAUSE_USER_BUSY);
-                    }
-                    return SWITCH_FALSE;
-                }
-            } else if (match_ringback_pattern(state->last_tone_duration_ms, 0)) {
-                state->consecutive_ringback++;
-                state->consecutive_busy = 0;
-                if (state->consecutive_ringback >= 1) {
-                    state->tone_type = RINGBACK_TONE_RINGBACK;
-                    /* 回铃音不停止，继续检测 */
-                }
-            } else {
-                state->consecutive_busy = 0;
-                state->consecutive_ringback = 0;
+        if (!job) {
+            globals.ready[id].waiting = 1;
+            switch_thread_cond_wait(globals.ready[id].cond, globals.ready_mutex);
+            globals.ready[id].waiting = 0;
+            continue;
+        }
+        switch_mutex_unlock(globals.ready_mutex);
+
+        /* 清除 queued 后复查：其间入队的帧由本线程接着处理，或已由生产者重新挂链 */
+        do {
+            job_run(job);
+            __atomic_store_n(&job->queued, 0, __ATOMIC_SEQ_CST);
+            __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        } while (!ringback_ring_empty(&job->ring) && !__atomic_exchange_n(&job->queued, 1, __ATOMIC_SEQ_CST));
+
+        switch_mutex_lock(globals.ready_mutex);
+    }
+    switch_mutex_unlock(globals.ready_mutex);
+    return NULL;
+}
+
+/* 首个卸载通道到来时按当前配置创建工作线程 (线程数、CPU 绑定此后不随 reload 变化) */
+static switch_status_t offload_start(const ringback_profile_t *profile)
+{
+    switch_threadattr_t *thd_attr = NULL;
+    int i;
+
+    switch_mutex_lock(globals.offload_mutex);
+    if (!globals.offload_running) {
+        if (!globals.jobs) {
+            globals.jobs = calloc(OFFLOAD_MAX_JOBS, sizeof(*globals.jobs));
+        }
+        if (globals.jobs) {
+            globals.nworkers = profile->workers;
+            globals.nworker_cpus = profile->nworker_cpus;
+            memcpy(globals.worker_cpus, profile->worker_cpus, sizeof(globals.worker_cpus));
+            globals.offload_running = 1;
+            for (i = 0; i < globals.nworkers; i++) {
+                switch_thread_cond_create(&globals.ready[i].cond, globals.pool);
+            }
+            switch_threadattr_create(&thd_attr, globals.pool);
+            switch_threadattr_stacksize_set(thd_attr, SWITCH_THREAD_STACKSIZE);
+            for (i = 0; i < globals.nworkers; i++) {
+                switch_thread_create(&globals.workers[i], thd_attr, offload_worker_run, (void *)(intptr_t)i,
+                                     globals.pool);
             }
-        } else if (state->silence_start_ms == 0) {
-            state->silence_start_ms = now_ms;
         }
     }
+    switch_mutex_unlock(globals.offload_mutex);
 
-    return SWITCH_TRUE;
+    return globals.offload_running ? SWITCH_STATUS_SUCCESS : SWITCH_STATUS_MEMERR;
+}
+
+/* 为通道分配任务，任务表已满返回 NULL (该通道在媒体线程分析) */
+static ringback_job_t *offload_acquire(ringback_state_t *state)
+{
+    ringback_job_t *job;
+
+    switch_mutex_lock(globals.offload_mutex);
+    if ((job = globals.free_jobs)) {
+        globals.free_jobs = job->next_free;
+    } else if (globals.njobs < OFFLOAD_MAX_JOBS && (job = calloc(1, sizeof(*job)))) {
+        ringback_ring_init(&job->ring);
+        job->owner = globals.njobs % globals.nworkers;
+        globals.jobs[globals.njobs] = job;
+        __atomic_store_n(&globals.njobs, globals.njobs + 1, __ATOMIC_RELEASE);
+    }
+    if (job) {
+        __atomic_store_n(&job->state, state, __ATOMIC_RELEASE);
+    }
+    switch_mutex_unlock(globals.offload_mutex);
+
+    return job;
+}
+
+/* 归还任务：等待工作线程处理完当前批次，清空队列后挂回空闲链表。调用前须已摘除 bug (不再有生产者) */
+static void offload_release(ringback_state_t *state)
+{
+    ringback_job_t *job = state->job;
+    int32_t idle = 0;
+
+    if (!job) {
+        return;
+    }
+    while (!__atomic_compare_exchange_n(&job->busy, &idle, 2, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+        idle = 0;
+        switch_cond_next();
+    }
+    job->state = NULL;
+    ringback_ring_init(&job->ring);
+
+    switch_mutex_lock(globals.offload_mutex);
+    job->next_free = globals.free_jobs;
+    globals.free_jobs = job;
+    switch_mutex_unlock(globals.offload_mutex);
+
+    __atomic_store_n(&job->busy, 0, __ATOMIC_RELEASE);
+    state->job = NULL;
+}
+
+/*
+ * 帧超过队列槽位 (如 re-INVITE 后 ptime 变大) 时由媒体线程收回任务：取得消费权后
+ * 处理完已入队的帧再归还，帧序不变，之后该通道在媒体线程分析
+ */
+static void offload_reclaim(ringback_state_t *state)
+{
+    ringback_job_t *job = state->job;
+    int32_t idle = 0;
+
+    while (!__atomic_compare_exchange_n(&job->busy, &idle, 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+        idle = 0;
+        switch_cond_next();
+    }
+    job_drain(job, state);
+    __atomic_store_n(&job->busy, 0, __ATOMIC_RELEASE);
+    offload_release(state);
+}
+
+/* 把跟踪缓冲解码为文本，配置已重新加载时规则只给出下标 */
+static void dump_trace(ringback_state_t *state, switch_stream_handle_t *stream)
+{
+    ringback_trace_rec_t *rec;
+    char line[512];
+    int i, n, shard;
+    const ringback_profile_t *profile;
+
+    if (!state->det.trace.size || !(rec = malloc(state->det.trace.size * sizeof(*rec)))) {
+        return;
+    }
+    n = ringback_trace_snapshot(&state->det.trace, rec, (int)state->det.trace.size);
+
+    shard = profile_shard(stream);
+    profile = profile_enter(shard);
+    stream->write_function(stream, "# %s %d records, result %s, rule %s\n",
+                           switch_core_session_get_uuid(state->session), n, tone_to_name(state->det.tone),
+                           state->rule_name[0] ? state->rule_name : "-");
+    for (i = 0; i < n; i++) {
+        ringback_trace_format(&rec[i], ringback_default_freqs, RINGBACK_DEFAULT_NBINS,
+                              state->generation == profile->generation ? &profile->tones : NULL, line, sizeof(line));
+        stream->write_function(stream, "%s\n", line);
+    }
+    profile_exit(shard);
+    free(rec);
 }
 
 /* 设置检测结果到通道变量 */
@@ -253,16 +910,186 @@ static void set_ringback_result(ringback_state_t *state)
 {
     switch_channel_t *channel = switch_core_session_get_channel(state->session);
     if (channel) {
-        switch_channel_set_variable(channel, "ringback_finish_cause",
-            state->tone_type == RINGBACK_TONE_BUSY ? "busy" :
-            state->tone_type == RINGBACK_TONE_RINGBACK ? "ringback" : "timeout");
-        switch_channel_set_variable(channel, "ringback_tone",
-            state->tone_type == RINGBACK_TONE_BUSY ? "busy" :
-            state->tone_type == RINGBACK_TONE_RINGBACK ? "ringback" : "unknown");
-        switch_channel_set_variable(channel, "ringback_result",
-            state->tone_type == RINGBACK_TONE_BUSY ? "busy" :
-            state->tone_type == RINGBACK_TONE_RINGBACK ? "ringback" : "unknown");
+        const char *tone = tone_to_name(state->det.tone);
+        const char *cause = state->finish_on_tone ? tone : state->finish_cause ? state->finish_cause : "timeout";
+        switch_channel_set_variable(channel, "ringback_finish_cause", cause);
+        RINGBACK_PROBE5(verdict, switch_core_session_get_uuid(state->session), tone, cause, state->det.decision_ms,
+                        state->rule_name);
+        switch_channel_set_variable(channel, "ringback_tone", tone);
+        switch_channel_set_variable(channel, state->result_variable, tone);
+        if (state->rule_name[0]) {
+            switch_channel_set_variable(channel, "ringback_rule", state->rule_name);
+        }
+        if (state->det.decision_ms) {
+            char buf[32];
+            switch_snprintf(buf, sizeof(buf), "%u", state->det.decision_ms);
+            switch_channel_set_variable(channel, "ringback_decision_ms", buf);
+            switch_snprintf(buf, sizeof(buf), "%.3f", state->det.confidence);
+            switch_channel_set_variable(channel, "ringback_confidence", buf);
+        }
+        /* 未识别的呼叫随挂机事件 (variable_ringback_trace) 带出判定过程 */
+        if (state->trace_on_unknown && state->det.trace.size && !strcmp(tone, "unknown")) {
+            switch_stream_handle_t stream = { 0 };
+            SWITCH_STANDARD_STREAM(stream);
+            dump_trace(state, &stream);
+            switch_channel_set_variable(channel, "ringback_trace", (char *)stream.data);
+            switch_safe_free(stream.data);
+        }
+    }
+}
+
+/* 开始挂接：卸载已开始时返回 0，否则计入挂接中，之后须以 attach_end 结束 */
+static int attach_begin(void)
+{
+    int ok;
+
+    switch_mutex_lock(globals.attach_mutex);
+    if ((ok = !globals.shutting_down)) {
+        globals.attaching++;
     }
+    switch_mutex_unlock(globals.attach_mutex);
+    return ok;
+}
+
+/* 结束挂接，state 非 NULL 表示挂接成功，加入已挂接链表 */
+static void attach_end(ringback_state_t *state)
+{
+    switch_mutex_lock(globals.attach_mutex);
+    if (state) {
+        state->prev_attached = NULL;
+        if ((state->next_attached = globals.attached)) {
+            globals.attached->prev_attached = state;
+        }
+        globals.attached = state;
+    }
+    globals.attaching--;
+    switch_mutex_unlock(globals.attach_mutex);
+}
+
+static void attach_unlink(ringback_state_t *state)
+{
+    switch_mutex_lock(globals.attach_mutex);
+    if (state->prev_attached) {
+        state->prev_attached->next_attached = state->next_attached;
+    } else if (globals.attached == state) {
+        globals.attached = state->next_attached;
+    }
+    if (state->next_attached) {
+        state->next_attached->prev_attached = state->prev_attached;
+    }
+    state->prev_attached = state->next_attached = NULL;
+    switch_mutex_unlock(globals.attach_mutex);
+}
+
+/*
+ * 从通道摘除检测 (接通、桥接、挂机、无帧超时)，调用方持有 session 的读锁，可在任意线程。
+ * 先摘除 media bug (等待在途回调退出)，仍在检测中则以 cause 写入结果
+ */
+static void detach_ringback(switch_core_session_t *session, const char *cause, int stat)
+{
+    switch_channel_t *channel = switch_core_session_get_channel(session);
+    ringback_state_t *state = switch_channel_get_private(channel, RINGBACK_PRIVATE);
+
+    if (!state || __atomic_exchange_n(&state->detached, 1, __ATOMIC_ACQ_REL)) {
+        return;
+    }
+    switch_channel_set_private(channel, RINGBACK_PRIVATE, NULL);
+    wheel_cancel(&state->deadline);
+
+    if (state->bug) {
+        switch_core_media_bug_remove(session, &state->bug);
+    }
+    offload_release(state);
+    if (state->running) {
+        state->finish_cause = cause;
+        stop_ringback(state);
+        if (stat >= 0) {
+            ringback_stats_inc(&globals.stats, ringback_stats_shard(), stat);
+        }
+        switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_DEBUG,
+                          "mod_ringback: detached on %s\n", cause ? cause : "timeout");
+    }
+}
+
+static void detach_uuid(const char *uuid, const char *cause, int stat)
+{
+    switch_core_session_t *session;
+
+    if (!zstr(uuid) && (session = switch_core_session_locate(uuid))) {
+        detach_ringback(session, cause, stat);
+        switch_core_session_rwunlock(session);
+    }
+}
+
+/* 接通/桥接后早期媒体已结束，立即摘除，不必等到最大检测时间 */
+static void channel_event_handler(switch_event_t *event)
+{
+    if (!__atomic_load_n(&globals.active, __ATOMIC_RELAXED)) {
+        return;
+    }
+    if (event->event_id == SWITCH_EVENT_CHANNEL_ANSWER) {
+        detach_uuid(switch_event_get_header(event, "Unique-ID"), "answer", RINGBACK_STAT_ANSWERED);
+    } else {
+        detach_uuid(switch_event_get_header(event, "Bridge-A-Unique-ID"), "bridge", RINGBACK_STAT_BRIDGED);
+        detach_uuid(switch_event_get_header(event, "Bridge-B-Unique-ID"), "bridge", RINGBACK_STAT_BRIDGED);
+    }
+}
+
+static switch_status_t ringback_on_hangup(switch_core_session_t *session)
+{
+    detach_ringback(session, "hangup", RINGBACK_STAT_HUNGUP);
+    return SWITCH_STATUS_SUCCESS;
+}
+
+static switch_status_t ringback_on_destroy(switch_core_session_t *session)
+{
+    ringback_state_t *state = switch_channel_get_private(switch_core_session_get_channel(session),
+                                                         RINGBACK_TRACE_PRIVATE);
+    if (state) {
+        attach_unlink(state);
+    }
+    return SWITCH_STATUS_SUCCESS;
+}
+
+static const switch_state_handler_table_t ringback_state_handlers = {
+    .on_hangup = ringback_on_hangup,
+    .on_destroy = ringback_on_destroy,
+};
+
+/*
+ * 截止时刻到期 (持有 wheel_mutex)：只记下通道 uuid，锁外再摘除。
+ * 通道摘除前必先取消定时器，所以此时 session 仍在
+ */
+static void deadline_expired(ringback_timer_t *t, void *arg)
+{
+    ringback_state_t *state = (ringback_state_t *)arg;
+
+    if (globals.nexpired == WHEEL_MAX_EXPIRED) {
+        ringback_wheel_add(&globals.wheel, t, globals.wheel.now);
+        return;
+    }
+    switch_copy_string(globals.expired[globals.nexpired++], switch_core_session_get_uuid(state->session),
+                       SWITCH_UUID_FORMATTED_LENGTH + 1);
+}
+
+/* 最大检测时间不再逐帧检查：时间轮到期即结束，没有早期媒体 (不来帧) 的通道也一样 */
+static void *SWITCH_THREAD_FUNC wheel_thread_run(switch_thread_t *thread, void *obj)
+{
+    int i;
+
+    while (globals.wheel_running) {
+        switch_yield(WHEEL_TICK_US);
+
+        switch_mutex_lock(globals.wheel_mutex);
+        ringback_wheel_advance(&globals.wheel, wheel_ticks_now());
+        switch_mutex_unlock(globals.wheel_mutex);
+
+        for (i = 0; i < globals.nexpired; i++) {
+            detach_uuid(globals.expired[i], NULL, RINGBACK_STAT_TIMEOUTS);
+        }
+        globals.nexpired = 0;
+    }
+    return NULL;
 }
 
 /* 启动回铃音检测 */
@@ -273,17 +1100,56 @@ static switch_status_t start_ringback(switch_core_session_t *session,
     switch_media_bug_t *bug = NULL;
     ringback_state_t *state = NULL;
     switch_status_t status;
-    switch_codec_t read_codec = { 0 };
+    switch_codec_t *read_codec;
+    switch_caller_profile_t *caller_profile;
+    const char *gateway;
+    int offload = 0, trace_seconds = 0;
+
+    if ((state = switch_channel_get_private(channel, RINGBACK_PRIVATE)) && state->running) {
+        switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_WARNING, "mod_ringback: already running\n");
+        return SWITCH_STATUS_FALSE;
+    }
+    if (!attach_begin()) {
+        switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_WARNING, "mod_ringback: module is unloading\n");
+        return SWITCH_STATUS_FALSE;
+    }
+    /* 通道上已有的检测 (已结束)：摘除并移出链表，由新状态接替 */
+    if ((state = switch_channel_get_private(channel, RINGBACK_TRACE_PRIVATE))) {
+        detach_ringback(session, NULL, -1);
+        attach_unlink(state);
+    }
 
     state = switch_core_session_alloc(session, sizeof(ringback_state_t));
     memset(state, 0, sizeof(ringback_state_t));
     state->session = session;
     state->running = 1;
-    state->max_detect_time_ms = 60000;  /* 默认 60 秒 */
-    state->autohangup = 1;
-    state->hangup_on_busy = 1;
-    state->hangup_on_ringback = 0;
-    state->start_time_ms = switch_micro_time_now() / 1000;
+    ringback_detector_init(&state->det, &bank_template, SAMPLE_RATE);
+    state->det.tag = switch_core_session_get_uuid(session);
+
+    /* 按被叫前缀 (回退网关名) 一次查找选出方案和参数，通道变量可再覆盖 */
+    caller_profile = switch_channel_get_caller_profile(channel);
+    if (caller_profile && !zstr(caller_profile->destination_number)) {
+        state->destination = switch_core_session_strdup(session, caller_profile->destination_number);
+    }
+    if ((gateway = switch_channel_get_variable(channel, "sip_gateway_name"))) {
+        state->gateway = switch_core_session_strdup(session, gateway);
+    }
+    {
+        int shard = profile_shard(state);
+        const ringback_profile_t *profile = profile_enter(shard);
+        const ringback_route_t *route = route_lookup(profile, state->destination, state->gateway);
+        /* generation 置 0，首帧按当前快照选择规则 */
+        state->generation = 0;
+        state->max_detect_time_ms = route->max_detect_time_ms;
+        state->autohangup = route->autohangup;
+        state->det.stoptones = route->stoptones;
+        state->result_variable = switch_core_session_strdup(session, profile->result_variable);
+        trace_seconds = profile->trace_seconds;
+        state->trace_on_unknown = profile->trace_on_unknown;
+        offload = profile->workers > 0 && offload_start(profile) == SWITCH_STATUS_SUCCESS;
+        profile_exit(shard);
+    }
+    state->batch_slot = -1;
 
     /* 从通道变量读取参数 */
     {
@@ -293,40 +1159,114 @@ static switch_status_t start_ringback(switch_core_session_t *session,
         }
         var = switch_channel_get_variable(channel, "ringback_autohangup");
         if (var) {
-            state->hangup_on_busy = switch_true(var);
+            state->autohangup = switch_true(var);
+        }
+        var = switch_channel_get_variable(channel, "ringback_stoptone");
+        if (var) {
+            state->det.stoptones = parse_stoptones(var);
+        }
+        var = switch_channel_get_variable(channel, "ringback_profiles");
+        if (!zstr(var)) {
+            state->profiles = switch_core_session_strdup(session, var);
+        }
+        var = switch_channel_get_variable(channel, "ringback_trace_seconds");
+        if (var) {
+            trace_seconds = atoi(var);
+        }
+        if (trace_seconds > 0) {
+            /* 每秒 50 个块，另留 1/4 给边沿和规则命中 */
+            uint32_t size = (uint32_t)trace_seconds * SAMPLE_RATE / RINGBACK_DETECTOR_BLOCK * 5 / 4;
+            ringback_trace_init(&state->det.trace, switch_core_session_alloc(session, size * sizeof(ringback_trace_rec_t)),
+                                size);
+        }
+        var = switch_channel_get_variable(channel, "ringback_batch");
+        if (var && switch_true(var) && batch_engine_start() == SWITCH_STATUS_SUCCESS) {
+            switch_mutex_lock(globals.mutex);
+            state->batch_slot = ringback_batch_acquire(globals.batch, state);
+            switch_mutex_unlock(globals.mutex);
+            if (state->batch_slot >= 0) {
+                state->det.block_fn = batch_blocks;
+                state->det.block_arg = state;
+            }
+        }
+        /* 批处理已在媒体线程外计算，不再卸载 */
+        var = switch_channel_get_variable(channel, "ringback_offload");
+        if (offload && state->batch_slot < 0 && (!var || switch_true(var))) {
+            state->job = offload_acquire(state);
         }
     }
 
-    switch_core_session_get_read_codec(session, &read_codec);
+    /* 按读编码采样率配置分析链路 */
+    read_codec = switch_core_session_get_read_codec(session);
+    if (ringback_detector_set_rate(&state->det, read_codec && read_codec->implementation ?
+                                   (int)read_codec->implementation->actual_samples_per_second : SAMPLE_RATE) < 0) {
+        switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_ERROR,
+                          "mod_ringback: Invalid read codec sample rate %u, not attaching\n",
+                          read_codec->implementation->actual_samples_per_second);
+        release_batch_slot(state);
+        offload_release(state);
+        attach_end(NULL);
+        return SWITCH_STATUS_FALSE;
+    }
+    if (state->det.rate != SAMPLE_RATE) {
+        /* 批处理引擎只支持 8kHz */
+        release_batch_slot(state);
+    }
+
+    /*
+     * 读流是 FreeSWITCH 解码后的 L16；PCMU/PCMA 线路改挂原生读 tap，
+     * 在解码前直接分析原始载荷 (ringback_native_g711=false 关闭)
+     */
+    if (read_codec && read_codec->implementation) {
+        const char *var = switch_channel_get_variable(channel, "ringback_native_g711");
+        if (!var || switch_true(var)) {
+            state->det.g711_law = ringback_g711_law(read_codec->implementation->iananame);
+        }
+    }
 
-    status = switch_core_session_create_media_bug(session, "ringback", 0,
-        ringback_media_callback, state, 0, SMBF_READ_PING, &bug);
+    status = switch_core_media_bug_add(session, "ringback", NULL, ringback_media_callback, state, 0,
+        state->det.g711_law != RINGBACK_G711_NONE ? SMBF_TAP_NATIVE_READ : SMBF_READ_STREAM, &bug);
     if (status != SWITCH_STATUS_SUCCESS) {
-        switch_log_printf(SWITCH_LOG_ERROR, "mod_ringback: Failed to create media bug\n");
+        switch_log_printf(SWITCH_CHANNEL_SESSION_LOG(session), SWITCH_LOG_ERROR, "mod_ringback: Failed to create media bug\n");
+        release_batch_slot(state);
+        offload_release(state);
+        attach_end(NULL);
         return status;
     }
 
     state->bug = bug;
+    __atomic_add_fetch(&globals.active, 1, __ATOMIC_RELAXED);
+    ringback_stats_inc(&globals.stats, ringback_stats_shard(), RINGBACK_STAT_STARTED);
+
+    /* 接通/桥接 (事件)、挂机 (状态回调)、超时 (时间轮) 时摘除 */
+    switch_channel_set_private(channel, RINGBACK_PRIVATE, state);
+    switch_channel_set_private(channel, RINGBACK_TRACE_PRIVATE, state);
+    switch_channel_add_state_handler(channel, &ringback_state_handlers);
+    if (state->max_detect_time_ms > 0) {
+        ringback_timer_init(&state->deadline, deadline_expired, state);
+        wheel_arm(&state->deadline, state->max_detect_time_ms);
+    }
+    attach_end(state);
 
     switch_channel_set_variable(channel, "ringback_active", "true");
+    RINGBACK_PROBE4(attach, switch_core_session_get_uuid(session), state->det.in_rate, state->max_detect_time_ms,
+                    state->job != NULL);
 
     return SWITCH_STATUS_SUCCESS;
 }
 
 /* API: uuid_start_ringback <uuid> */
-static switch_status_t api_uuid_start_ringback(const char *cmd, const char *args,
-                                               switch_core_session_t *session,
-                                               switch_stream_handle_t *stream)
+SWITCH_STANDARD_API(api_uuid_start_ringback)
 {
     switch_core_session_t *target_session = NULL;
     switch_status_t status;
 
-    if (!args || !*args) {
+    if (zstr(cmd)) {
         stream->write_function(stream, "-ERR Usage: uuid_start_ringback <uuid>\n");
         return SWITCH_STATUS_SUCCESS;
     }
 
-    target_session = switch_core_session_locate(args);
+    target_session = switch_core_session_locate(cmd);
     if (!target_session) {
         stream->write_function(stream, "-ERR No such channel\n");
         return SWITCH_STATUS_SUCCESS;
@@ -339,6 +1279,190 @@ static switch_status_t api_uuid_start_ringback(const char *cmd, const char *args
     return SWITCH_STATUS_SUCCESS;
 }
 
+/* API: uuid_ringback_trace <uuid> */
+SWITCH_STANDARD_API(api_uuid_ringback_trace)
+{
+    switch_core_session_t *target_session;
+    ringback_state_t *state;
+
+    if (zstr(cmd)) {
+        stream->write_function(stream, "-ERR Usage: uuid_ringback_trace <uuid>\n");
+        return SWITCH_STATUS_SUCCESS;
+    }
+    if (!(target_session = switch_core_session_locate(cmd))) {
+        stream->write_function(stream, "-ERR No such channel\n");
+        return SWITCH_STATUS_SUCCESS;
+    }
+
+    state = switch_channel_get_private(switch_core_session_get_channel(target_session), RINGBACK_TRACE_PRIVATE);
+    if (!state || !state->det.trace.size) {
+        stream->write_function(stream, "-ERR No trace on this channel\n");
+    } else {
+        dump_trace(state, stream);
+    }
+    switch_core_session_rwunlock(target_session);
+    return SWITCH_STATUS_SUCCESS;
+}
+
+#define RINGBACK_API_USAGE "status|reload"
+
+/* API: ringback status / ringback reload */
+SWITCH_STANDARD_API(api_ringback)
+{
+    const ringback_kernel_t *kernel = ringback_kernel_current();
+    int i;
+
+    if (zstr(cmd) || !strcasecmp(cmd, "status")) {
+        stream->write_function(stream, "kernel: %s\n", kernel->name);
+        stream->write_function(stream, "kernel_ns_per_frame: %.1f\n", ringback_kernel_ns(kernel));
+        stream->write_function(stream, "kernels:");
+        for (i = 0; i < ringback_kernel_count(); i++) {
+            const ringback_kernel_t *k = ringback_kernel_get(i);
+            if (k->supported()) {
+                stream->write_function(stream, " %s=%.1f", k->name, ringback_kernel_ns(k));
+            } else {
+                stream->write_function(stream, " %s=unsupported", k->name);
+            }
+        }
+        stream->write_function(stream, "\nbank_bins: %d\n", RINGBACK_DEFAULT_NBINS);
+        stream->write_function(stream, "batch_engine: %s\n", globals.batch ? "running" : "off");
+        stream->write_function(stream, "active: %d\n", __atomic_load_n(&globals.active, __ATOMIC_RELAXED));
+        stream->write_function(stream, "offload: %d workers, %d jobs, drops %" SWITCH_UINT64_T_FMT
+                               ", steals %" SWITCH_UINT64_T_FMT "\n", globals.offload_running ? globals.nworkers : 0,
+                               __atomic_load_n(&globals.njobs, __ATOMIC_RELAXED),
+                               __atomic_load_n(&globals.offload_drops, __ATOMIC_RELAXED),
+                               __atomic_load_n(&globals.offload_steals, __ATOMIC_RELAXED));
+        {
+            ringback_stats_shard_t sum;
+            ringback_stats_sum(&globals.stats, &sum);
+            stream->write_function(stream, "decisions: %" SWITCH_UINT64_T_FMT " (early %" SWITCH_UINT64_T_FMT ")\n",
+                                   sum.verdict_ms.count, sum.counter[RINGBACK_STAT_EARLY]);
+            stream->write_function(stream, "avg_decision_ms: %" SWITCH_UINT64_T_FMT "\n",
+                                   sum.verdict_ms.count ? sum.verdict_ms.sum / sum.verdict_ms.count : 0);
+            stream->write_function(stream, "monitoring: %d (resumed %" SWITCH_UINT64_T_FMT ")\n",
+                                   __atomic_load_n(&globals.monitoring, __ATOMIC_RELAXED),
+                                   __atomic_load_n(&globals.monitor_resumes, __ATOMIC_RELAXED));
+        }
+        {
+            int shard = profile_shard(stream);
+            const ringback_profile_t *profile = profile_enter(shard);
+            stream->write_function(stream, "profile_generation: %u\n", profile->generation);
+            stream->write_function(stream, "confidence: %.3f\n", profile->tones.confidence);
+            stream->write_function(stream, "min_purity: %.2f max_twist_db: %.1f max_harmonic_db: %.1f\n",
+                                   profile->tones.min_purity, profile->tones.max_twist_db,
+                                   profile->tones.max_harmonic_db);
+            stream->write_function(stream, "snr_db: %.1f hysteresis_db: %.1f min_gap_ms: %u\n",
+                                   profile->tones.snr_db, profile->tones.hysteresis_db, profile->tones.min_gap_ms);
+            stream->write_function(stream, "monitor_interval: %d\n", profile->monitor_interval);
+            stream->write_function(stream, "trace_seconds: %d%s\n", profile->trace_seconds,
+                                   profile->trace_on_unknown ? " (on unknown)" : "");
+            stream->write_function(stream, "profiles:");
+            for (i = 0; i < profile->tones.nprofiles; i++) {
+                stream->write_function(stream, " %s%s", profile->tones.profile_name[i],
+                                       (profile->routes[0].rules & profile->tones.profile_rules[i]) ? "*" : "");
+            }
+            stream->write_function(stream, "\nroutes: %d (%d prefix nodes, %d gateways)\n",
+                                   profile->nroutes - 1, profile->prefixes.nnodes, profile->ngateways);
+            profile_exit(shard);
+        }
+        return SWITCH_STATUS_SUCCESS;
+    }
+
+    if (!strcasecmp(cmd, "reload")) {
+        if (reload_profile() == SWITCH_STATUS_SUCCESS) {
+            stream->write_function(stream, "+OK\n");
+        } else {
+            stream->write_function(stream, "-ERR reload failed, keeping current profile\n");
+        }
+        return SWITCH_STATUS_SUCCESS;
+    }
+
+    stream->write_function(stream, "-ERR Usage: ringback " RINGBACK_API_USAGE "\n");
+    return SWITCH_STATUS_SUCCESS;
+}
+
+#define RINGBACK_STATS_USAGE "[json|prometheus]"
+
+static void write_hist_prometheus(switch_stream_handle_t *stream, const char *name, const ringback_hist_t *h)
+{
+    uint64_t acc = 0;
+    int i;
+
+    stream->write_function(stream, "# TYPE ringback_%s histogram\n", name);
+    for (i = 0; i < RINGBACK_HIST_BUCKETS - 1; i++) {
+        acc += h->bucket[i];
+        stream->write_function(stream, "ringback_%s_bucket{le=\"%" SWITCH_UINT64_T_FMT "\"} %" SWITCH_UINT64_T_FMT "\n",
+                               name, ringback_hist_bound(i), acc);
+    }
+    acc += h->bucket[RINGBACK_HIST_BUCKETS - 1];
+    stream->write_function(stream, "ringback_%s_bucket{le=\"+Inf\"} %" SWITCH_UINT64_T_FMT "\n", name, acc);
+    stream->write_function(stream, "ringback_%s_sum %" SWITCH_UINT64_T_FMT "\n", name, h->sum);
+    stream->write_function(stream, "ringback_%s_count %" SWITCH_UINT64_T_FMT "\n", name, acc);
+}
+
+/*
+ * API: ringback_stats [json|prometheus]
+ * 读取时汇总各分片，不加锁，也不打断媒体线程
+ */
+SWITCH_STANDARD_API(api_ringback_stats)
+{
+    ringback_stats_shard_t sum;
+    int64_t active;
+    int c;
+
+    ringback_stats_sum(&globals.stats, &sum);
+    active = (int64_t)(sum.counter[RINGBACK_STAT_STARTED] - sum.counter[RINGBACK_STAT_STOPPED]);
+
+    if (zstr(cmd)) {
+        for (c = 0; c < RINGBACK_STAT_COUNTERS; c++) {
+            stream->write_function(stream, "%s: %" SWITCH_UINT64_T_FMT "\n", ringback_stat_name(c), sum.counter[c]);
+        }
+        stream->write_function(stream, "active: %" SWITCH_INT64_T_FMT "\n", active);
+        stream->write_function(stream, "callback_ns: p50 %" SWITCH_UINT64_T_FMT " p99 %" SWITCH_UINT64_T_FMT "\n",
+                               ringback_hist_quantile(&sum.callback_ns, 0.5),
+                               ringback_hist_quantile(&sum.callback_ns, 0.99));
+        stream->write_function(stream, "verdict_ms: p50 %" SWITCH_UINT64_T_FMT " p99 %" SWITCH_UINT64_T_FMT "\n",
+                               ringback_hist_quantile(&sum.verdict_ms, 0.5),
+                               ringback_hist_quantile(&sum.verdict_ms, 0.99));
+        return SWITCH_STATUS_SUCCESS;
+    }
+
+    if (!strcasecmp(cmd, "json")) {
+        stream->write_function(stream, "{");
+        for (c = 0; c < RINGBACK_STAT_COUNTERS; c++) {
+            stream->write_function(stream, "\"%s\":%" SWITCH_UINT64_T_FMT ",", ringback_stat_name(c), sum.counter[c]);
+        }
+        stream->write_function(stream, "\"active\":%" SWITCH_INT64_T_FMT ",", active);
+        stream->write_function(stream, "\"callback_ns\":{\"count\":%" SWITCH_UINT64_T_FMT ",\"sum\":%"
+                               SWITCH_UINT64_T_FMT ",\"p50\":%" SWITCH_UINT64_T_FMT ",\"p99\":%"
+                               SWITCH_UINT64_T_FMT "},", sum.callback_ns.count, sum.callback_ns.sum,
+                               ringback_hist_quantile(&sum.callback_ns, 0.5),
+                               ringback_hist_quantile(&sum.callback_ns, 0.99));
+        stream->write_function(stream, "\"verdict_ms\":{\"count\":%" SWITCH_UINT64_T_FMT ",\"sum\":%"
+                               SWITCH_UINT64_T_FMT ",\"p50\":%" SWITCH_UINT64_T_FMT ",\"p99\":%"
+                               SWITCH_UINT64_T_FMT "}}\n", sum.verdict_ms.count, sum.verdict_ms.sum,
+                               ringback_hist_quantile(&sum.verdict_ms, 0.5),
+                               ringback_hist_quantile(&sum.verdict_ms, 0.99));
+        return SWITCH_STATUS_SUCCESS;
+    }
+
+    if (!strcasecmp(cmd, "prometheus")) {
+        for (c = 0; c < RINGBACK_STAT_COUNTERS; c++) {
+            stream->write_function(stream, "# TYPE ringback_%s_total counter\n", ringback_stat_name(c));
+            stream->write_function(stream, "ringback_%s_total %" SWITCH_UINT64_T_FMT "\n", ringback_stat_name(c),
+                                   sum.counter[c]);
+        }
+        stream->write_function(stream, "# TYPE ringback_active gauge\n");
+        stream->write_function(stream, "ringback_active %" SWITCH_INT64_T_FMT "\n", active);
+        write_hist_prometheus(stream, "callback_ns", &sum.callback_ns);
+        write_hist_prometheus(stream, "verdict_ms", &sum.verdict_ms);
+        return SWITCH_STATUS_SUCCESS;
+    }
+
+    stream->write_function(stream, "-ERR Usage: ringback_stats " RINGBACK_STATS_USAGE "\n");
+    return SWITCH_STATUS_SUCCESS;
+}
+
 /* 应用接口 */
 SWITCH_MODULE_LOAD_FUNCTION(mod_ringback_load);
 SWITCH_MODULE_SHUTDOWN_FUNCTION(mod_ringback_shutdown);
@@ -350,6 +1474,291 @@ SWITCH_STANDARD_APP(start_ringback_app)
 
 SWITCH_MODULE_DEFINITION(mod_ringback, mod_ringback_load, mod_ringback_shutdown, NULL);
 
+/*
+ * 向方案追加一条规则，格式错误时记录日志并跳过。
+ * freq 为空表示只按能量判断有音，否则为 "425" 或 "440+480"
+ */
+static void add_rule(ringback_toneset_t *tones, const char *profile, const char *name, const char *tone,
+                     const char *freq, const char *pattern, int cycles)
+{
+    ringback_cadence_rule_t rule;
+    double freqs[2] = { 0, 0 };
+    int nfreqs = 0, t = tone_from_name(tone);
+
+    if (!zstr(freq)) {
+        nfreqs = sscanf(freq, "%lf+%lf", &freqs[0], &freqs[1]);
+    }
+    if (!t || nfreqs < 0 || ringback_cadence_parse(&rule, name, t, pattern, cycles) != 0 ||
+        rule.nseg * rule.cycles > 32) {
+        switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_ERROR,
+                          "mod_ringback: invalid rule %s (tone=%s pattern=%s)\n", name, tone, pattern);
+        return;
+    }
+    if (ringback_toneset_add_rule(tones, profile, &rule, freqs, nfreqs) < 0) {
+        switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING,
+                          "mod_ringback: rule %s ignored (too many rules or frequency %s not in filter bank)\n",
+                          name, freq);
+    }
+}
+
+/*
+ * 解析 <routes>：按被叫前缀 (逗号分隔多个) 或网关名指定方案和参数，
+ * 未写的属性继承 settings 中的默认值。例如
+ *   <route prefix="86,852" profiles="cn"/>
+ *   <route prefix="1" profiles="us" energy_threshold="400" maxdetecttime="40"/>
+ *   <route gateway="carrier_uk" profiles="uk,default"/>
+ */
+static switch_status_t load_routes(ringback_profile_t *profile, const ringback_route_t *defaults, switch_xml_t section)
+{
+    switch_xml_t x;
+    int n = 1;
+
+    for (x = section ? switch_xml_child(section, "route") : NULL; x; x = x->next) {
+        n++;
+    }
+    profile->routes = calloc(n, sizeof(*profile->routes));
+    profile->gateways = calloc(n, sizeof(*profile->gateways));
+    if (!profile->routes || !profile->gateways) {
+        return SWITCH_STATUS_MEMERR;
+    }
+    profile->routes[0] = *defaults;
+    profile->nroutes = 1;
+
+    for (x = section ? switch_xml_child(section, "route") : NULL; x; x = x->next) {
+        ringback_route_t *route = &profile->routes[profile->nroutes];
+        const char *prefix = switch_xml_attr_soft(x, "prefix");
+        const char *gateway = switch_xml_attr_soft(x, "gateway");
+        const char *value;
+
+        if (zstr(prefix) && zstr(gateway)) {
+            switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "mod_ringback: route without prefix or gateway ignored\n");
+            continue;
+        }
+
+        *route = *defaults;
+        if (!zstr(value = switch_xml_attr_soft(x, "profiles"))) {
+            route->rules = ringback_toneset_select(&profile->tones, value);
+        }
+        if (atoi(value = switch_xml_attr_soft(x, "energy_threshold")) > 0) {
+            route->energy_threshold = atoi(value);
+        }
+        if (atoi(value = switch_xml_attr_soft(x, "maxdetecttime")) > 0) {
+            route->max_detect_time_ms = atoi(value) * 1000;
+        }
+        if (!zstr(value = switch_xml_attr_soft(x, "stoptone"))) {
+            route->stoptones = parse_stoptones(value);
+        }
+        if (!zstr(value = switch_xml_attr_soft(x, "autohangup"))) {
+            route->autohangup = switch_true(value);
+        }
+
+        if (!zstr(prefix)) {
+            char buf[256], *tok, *save = NULL;
+            switch_copy_string(buf, prefix, sizeof(buf));
+            for (tok = strtok_r(buf, ", ", &save); tok; tok = strtok_r(NULL, ", ", &save)) {
+                if (ringback_prefix_add(&profile->prefixes, tok, profile->nroutes) != 0) {
+                    switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "mod_ringback: invalid route prefix %s\n", tok);
+                }
+            }
+        }
+        if (!zstr(gateway)) {
+            ringback_gateway_route_t *gw = &profile->gateways[profile->ngateways++];
+            switch_copy_string(gw->name, gateway, sizeof(gw->name));
+            gw->route = profile->nroutes;
+        }
+        profile->nroutes++;
+    }
+
+    return SWITCH_STATUS_SUCCESS;
+}
+
+/*
+ * 加载 ringback.conf.xml 并编译时序规则。
+ * <settings> 中的 tone_busy_rule 等为单周期 响|停 规则，属于 default 方案；
+ * 内置各国方案 (ringback_tones) 以国家代码为方案名；
+ * <rules> 中可追加多段规则，例如英国双振铃：
+ *   <rule name="uk_ringback" tone="ringback" freq="400+450" pattern="350-450|150-250|350-450|1800-2200"/>
+ */
+static ringback_profile_t *load_profile(void)
+{
+    const char *busy = RINGBACK_DEFAULT_BUSY_RULE, *ringback = RINGBACK_DEFAULT_RINGBACK_RULE, *congestion = RINGBACK_DEFAULT_CONGESTION_RULE;
+    const char *tone_freq = RINGBACK_DEFAULT_TONE_FREQ;
+    const char *profiles = "default";
+    switch_xml_t cfg = NULL, xml, settings, section, param;
+    ringback_profile_t *profile;
+    ringback_route_t defaults;
+    int i;
+
+    profile = calloc(1, sizeof(*profile));
+    if (!profile || ringback_prefix_init(&profile->prefixes) != 0) {
+        free(profile);
+        return NULL;
+    }
+    memset(&defaults, 0, sizeof(defaults));
+    defaults.stoptones = RINGBACK_TONE_BUSY;
+    defaults.autohangup = 1;
+    defaults.max_detect_time_ms = DEFAULT_MAX_DETECT_TIME * 1000;
+    defaults.energy_threshold = RINGBACK_DEFAULT_ENERGY;
+    switch_copy_string(profile->result_variable, "ringback_result", sizeof(profile->result_variable));
+    ringback_toneset_init(&profile->tones, ringback_default_freqs, RINGBACK_DEFAULT_NBINS);
+    profile->tones.confidence = DEFAULT_CONFIDENCE;
+    profile->monitor_interval = DEFAULT_MONITOR_INTERVAL;
+    profile->trace_seconds = DEFAULT_TRACE_SECONDS;
+
+    xml = switch_xml_open_cfg("ringback.conf", &cfg, NULL);
+    if (!xml) {
+        switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "mod_ringback: ringback.conf not found, using defaults\n");
+    }
+
+    if (xml && (settings = switch_xml_child(cfg, "settings"))) {
+        for (param = switch_xml_child(settings, "param"); param; param = param->next) {
+            const char *name = switch_xml_attr_soft(param, "name");
+            const char *value = switch_xml_attr_soft(param, "value");
+
+            if (!strcasecmp(name, "stoptone")) {
+                defaults.stoptones = parse_stoptones(value);
+            } else if (!strcasecmp(name, "autohangup")) {
+                defaults.autohangup = switch_true(value);
+            } else if (!strcasecmp(name, "maxdetecttime")) {
+                if (atoi(value) > 0) {
+                    defaults.max_detect_time_ms = atoi(value) * 1000;
+                }
+            } else if (!strcasecmp(name, "energy_threshold")) {
+                if (atoi(value) > 0) {
+                    defaults.energy_threshold = atoi(value);
+                }
+            } else if (!strcasecmp(name, "confidence")) {
+                double c = atof(value);
+                if (c >= 0 && c < 1) {
+                    profile->tones.confidence = c;
+                }
+            } else if (!strcasecmp(name, "tone_freq")) {
+                tone_freq = value;
+            } else if (!strcasecmp(name, "min_purity")) {
+                profile->tones.min_purity = atof(value);
+            } else if (!strcasecmp(name, "max_twist_db")) {
+                profile->tones.max_twist_db = atof(value);
+            } else if (!strcasecmp(name, "max_harmonic_db")) {
+                profile->tones.max_harmonic_db = atof(value);
+            } else if (!strcasecmp(name, "snr_db")) {
+                profile->tones.snr_db = atof(value);
+            } else if (!strcasecmp(name, "hysteresis_db")) {
+                profile->tones.hysteresis_db = atof(value);
+            } else if (!strcasecmp(name, "min_gap_ms")) {
+                if (atoi(value) >= 0) {
+                    profile->tones.min_gap_ms = atoi(value);
+                }
+            } else if (!strcasecmp(name, "workers")) {
+                int n = atoi(value);
+                profile->workers = n < 0 ? 0 : n > OFFLOAD_MAX_WORKERS ? OFFLOAD_MAX_WORKERS : n;
+            } else if (!strcasecmp(name, "worker_cpus")) {
+                const char *p = value;
+                profile->nworker_cpus = 0;
+                while (*p && profile->nworker_cpus < OFFLOAD_MAX_WORKERS) {
+                    profile->worker_cpus[profile->nworker_cpus++] = atoi(p);
+                    if (!(p = strchr(p, ','))) {
+                        break;
+                    }
+                    p++;
+                }
+            } else if (!strcasecmp(name, "monitor_interval")) {
+                if (atoi(value) >= 0) {
+                    profile->monitor_interval = atoi(value);
+                }
+            } else if (!strcasecmp(name, "trace_seconds")) {
+                if (atoi(value) >= 0) {
+                    profile->trace_seconds = atoi(value);
+                }
+            } else if (!strcasecmp(name, "trace_on_unknown")) {
+                profile->trace_on_unknown = switch_true(value);
+            } else if (!strcasecmp(name, "tone_busy_rule")) {
+                busy = value;
+            } else if (!strcasecmp(name, "tone_ringback_rule")) {
+                ringback = value;
+            } else if (!strcasecmp(name, "tone_congestion_rule")) {
+                congestion = value;
+            } else if (!strcasecmp(name, "profiles")) {
+                profiles = value;
+            } else if (!strcasecmp(name, "result_variable")) {
+                if (!zstr(value)) {
+                    switch_copy_string(profile->result_variable, value, sizeof(profile->result_variable));
+                }
+            }
+        }
+    }
+
+    /* 忙音、拥塞音需连续两个周期，回铃音一个周期 (周期长，误判风险低) */
+    add_rule(&profile->tones, "default", "busy", "busy", tone_freq, busy, 2);
+    add_rule(&profile->tones, "default", "congestion", "congestion", tone_freq, congestion, 2);
+    add_rule(&profile->tones, "default", "ringback", "ringback", tone_freq, ringback, 1);
+
+    if (xml && (section = switch_xml_child(cfg, "rules"))) {
+        for (param = switch_xml_child(section, "rule"); param; param = param->next) {
+            const char *cycles = switch_xml_attr_soft(param, "cycles");
+            const char *owner = switch_xml_attr_soft(param, "profile");
+            add_rule(&profile->tones, zstr(owner) ? "default" : owner, switch_xml_attr_soft(param, "name"),
+                     switch_xml_attr_soft(param, "tone"), switch_xml_attr_soft(param, "freq"),
+                     switch_xml_attr_soft(param, "pattern"), zstr(cycles) ? 1 : atoi(cycles));
+        }
+    }
+
+    for (i = 0; i < ringback_country_count(); i++) {
+        if (ringback_toneset_add_country(&profile->tones, ringback_country_get(i)) < 0) {
+            switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "mod_ringback: built-in profile %s skipped\n",
+                              ringback_country_get(i)->code);
+        }
+    }
+
+    if (ringback_toneset_compile(&profile->tones) != 0) {
+        if (cfg) {
+            switch_xml_free(cfg);
+        }
+        profile_free(profile);
+        return NULL;
+    }
+    defaults.rules = ringback_toneset_select(&profile->tones, profiles);
+
+    if (load_routes(profile, &defaults, xml ? switch_xml_child(cfg, "routes") : NULL) != SWITCH_STATUS_SUCCESS) {
+        if (cfg) {
+            switch_xml_free(cfg);
+        }
+        profile_free(profile);
+        return NULL;
+    }
+
+    if (cfg) {
+        switch_xml_free(cfg);
+    }
+
+    switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_INFO, "mod_ringback: %d cadence rules, %d profiles, %d tone signatures\n",
+                      profile->tones.nrules, profile->tones.nprofiles, profile->tones.nsig);
+    return profile;
+}
+
+/* 重新解析配置并发布新快照，失败时保留当前快照 */
+static switch_status_t reload_profile(void)
+{
+    ringback_profile_t *profile;
+
+    switch_mutex_lock(globals.reload_mutex);
+    profile = load_profile();
+    if (profile) {
+        const ringback_profile_t *cur = __atomic_load_n(&globals.profile, __ATOMIC_ACQUIRE);
+        profile->generation = cur ? cur->generation + 1 : 1;
+        profile_publish(profile);
+    }
+    switch_mutex_unlock(globals.reload_mutex);
+
+    return profile ? SWITCH_STATUS_SUCCESS : SWITCH_STATUS_GENERR;
+}
+
+/* reloadxml 后自动重新加载 */
+static void reload_xml_event_handler(switch_event_t *event)
+{
+    reload_profile();
+}
+
+
 SWITCH_MODULE_LOAD_FUNCTION(mod_ringback_load)
 {
     switch_application_interface_t *app_interface;
@@ -357,19 +1766,153 @@ SWITCH_MODULE_LOAD_FUNCTION(mod_ringback_load)
 
     *module_interface = switch_loadable_module_create_module_interface(pool, modname);
 
+    memset(&globals, 0, sizeof(globals));
+    globals.pool = pool;
+    switch_mutex_init(&globals.mutex, SWITCH_MUTEX_NESTED, pool);
+    switch_mutex_init(&globals.reload_mutex, SWITCH_MUTEX_NESTED, pool);
+    switch_mutex_init(&globals.wheel_mutex, SWITCH_MUTEX_NESTED, pool);
+    switch_mutex_init(&globals.offload_mutex, SWITCH_MUTEX_NESTED, pool);
+    switch_mutex_init(&globals.ready_mutex, SWITCH_MUTEX_DEFAULT, pool);
+    switch_mutex_init(&globals.attach_mutex, SWITCH_MUTEX_NESTED, pool);
+    ringback_stats_clock_init();
+    globals.wheel_epoch = switch_micro_time_now();
+    ringback_wheel_init(&globals.wheel, 0);
+
+    if (reload_profile() != SWITCH_STATUS_SUCCESS) {
+        return SWITCH_STATUS_TERM;
+    }
+    if (switch_event_bind_removable(modname, SWITCH_EVENT_RELOADXML, NULL, reload_xml_event_handler,
+                                    NULL, &globals.reload_node) != SWITCH_STATUS_SUCCESS) {
+        switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING, "mod_ringback: couldn't bind reloadxml event\n");
+    }
+    if (switch_event_bind_removable(modname, SWITCH_EVENT_CHANNEL_ANSWER, NULL, channel_event_handler,
+                                    NULL, &globals.answer_node) != SWITCH_STATUS_SUCCESS ||
+        switch_event_bind_removable(modname, SWITCH_EVENT_CHANNEL_BRIDGE, NULL, channel_event_handler,
+                                    NULL, &globals.bridge_node) != SWITCH_STATUS_SUCCESS) {
+        switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_WARNING,
+                          "mod_ringback: couldn't bind answer/bridge events, detection stops at maxdetecttime\n");
+    }
+
+    /* 配置加载成功后才启动时间轮线程，加载失败直接返回时没有需要停止的线程 */
+    {
+        switch_threadattr_t *thd_attr = NULL;
+        globals.wheel_running = 1;
+        switch_threadattr_create(&thd_attr, pool);
+        switch_threadattr_stacksize_set(thd_attr, SWITCH_THREAD_STACKSIZE);
+        switch_thread_create(&globals.wheel_thread, thd_attr, wheel_thread_run, NULL, pool);
+    }
+
+    /* 按 CPUID 和自校准选择 DSP 内核，同一个 .so 适配不同代 CPU */
+    ringback_dsp_init();
+    ringback_dsp_calibrate(RINGBACK_DEFAULT_NBINS);
+    ringback_bank_init(&bank_template, ringback_default_freqs, RINGBACK_DEFAULT_NBINS, SAMPLE_RATE);
+    switch_log_printf(SWITCH_CHANNEL_LOG, SWITCH_LOG_INFO,
+                      "mod_ringback: DSP kernel %s, %.1f ns/frame (%d bins, %d samples)\n",
+                      ringback_kernel_current()->name, ringback_kernel_ns(ringback_kernel_current()),
+                      RINGBACK_DEFAULT_NBINS, RINGBACK_CALIB_FRAME);
+
     SWITCH_ADD_APPLICATION(app_interface, "start_ringback", "Start ringback tone detection",
                           "Start ringback tone detection on early media",
                           start_ringback_app, "", SAF_NONE);
 
     SWITCH_ADD_API(api_interface, "uuid_start_ringback", "Start ringback detection on UUID",
-                   "uuid_start_ringback <uuid>", api_uuid_start_ringback, "");
+                   api_uuid_start_ringback, "<uuid>");
+    SWITCH_ADD_API(api_interface, "uuid_ringback_trace", "Dump the ringback decision trace of a channel",
+                   api_uuid_ringback_trace, "<uuid>");
+    SWITCH_ADD_API(api_interface, "ringback", "mod_ringback status", api_ringback, RINGBACK_API_USAGE);
+    SWITCH_ADD_API(api_interface, "ringback_stats", "mod_ringback counters and latency histograms",
+                   api_ringback_stats, RINGBACK_STATS_USAGE);
 
-    switch_console_set_complete("add uuid_start_ringback");
+    switch_console_set_complete("add uuid_start_ringback ::console::list_uuid");
+    switch_console_set_complete("add uuid_ringback_trace ::console::list_uuid");
+    switch_console_set_complete("add ringback status");
+    switch_console_set_complete("add ringback reload");
+    switch_console_set_complete("add ringback_stats json");
+    switch_console_set_complete("add ringback_stats prometheus");
 
     return SWITCH_STATUS_SUCCESS;
 }
 
 SWITCH_MODULE_SHUTDOWN_FUNCTION(mod_ringback_shutdown)
 {
+    switch_status_t st;
+    int i;
+
+    /* 不再接收事件；拒绝新的挂接，等挂接中的通道完成 */
+    switch_event_unbind(&globals.reload_node);
+    switch_event_unbind(&globals.answer_node);
+    switch_event_unbind(&globals.bridge_node);
+    switch_mutex_lock(globals.attach_mutex);
+    globals.shutting_down = 1;
+    switch_mutex_unlock(globals.attach_mutex);
+
+    /*
+     * 逐个清理挂过检测的通道：摘除 media bug (等待在途回调)、归还任务和批处理槽位，
+     * 再移除指向本模块的状态回调。通道已在销毁中时等它的 on_destroy 移出链表
+     */
+    for (;;) {
+        char uuid[SWITCH_UUID_FORMATTED_LENGTH + 1];
+        switch_core_session_t *session;
+        ringback_state_t *state;
+
+        switch_mutex_lock(globals.attach_mutex);
+        if (!(state = globals.attached)) {
+            int attaching = globals.attaching;
+            switch_mutex_unlock(globals.attach_mutex);
+            if (!attaching) {
+                break;
+            }
+            switch_yield(1000);
+            continue;
+        }
+        switch_copy_string(uuid, switch_core_session_get_uuid(state->session), sizeof(uuid));
+        switch_mutex_unlock(globals.attach_mutex);
+
+        if ((session = switch_core_session_locate(uuid))) {
+            detach_ringback(session, "shutdown", -1);
+            switch_channel_clear_state_handler(switch_core_session_get_channel(session), &ringback_state_handlers);
+            attach_unlink(state);
+            switch_core_session_rwunlock(session);
+        } else {
+            switch_yield(10000);
+        }
+    }
+
+    /* 已没有媒体回调：停止并等待各线程 */
+    if (globals.batch_thread) {
+        globals.batch_running = 0;
+        switch_thread_join(&st, globals.batch_thread);
+        globals.batch_thread = NULL;
+    }
+    if (globals.wheel_thread) {
+        globals.wheel_running = 0;
+        switch_thread_join(&st, globals.wheel_thread);
+        globals.wheel_thread = NULL;
+    }
+    if (globals.offload_running) {
+        switch_mutex_lock(globals.ready_mutex);
+        globals.offload_running = 0;
+        for (i = 0; i < globals.nworkers; i++) {
+            switch_thread_cond_signal(globals.ready[i].cond);
+        }
+        switch_mutex_unlock(globals.ready_mutex);
+        for (i = 0; i < globals.nworkers; i++) {
+            switch_thread_join(&st, globals.workers[i]);
+        }
+    }
+
+    /* 最后释放：任务、批处理引擎，配置快照等各分片读者退出后释放 */
+    if (globals.jobs) {
+        for (i = 0; i < globals.njobs; i++) {
+            free(globals.jobs[i]);
+        }
+        free(globals.jobs);
+        globals.jobs = NULL;
+        globals.njobs = 0;
+    }
+    ringback_batch_destroy(globals.batch);
+    globals.batch = NULL;
+    profile_publish(NULL);
+
     return SWITCH_STATUS_SUCCESS;
 }
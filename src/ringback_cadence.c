@@ -0,0 +1,148 @@
+/*
+ * ringback_cadence - 信号音时序自动机实现
+ */
+
+#include "ringback_cadence.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+int ringback_cadence_parse(ringback_cadence_rule_t *rule, const char *name, int tone,
+                           const char *spec, int cycles)
+{
+    const char *p = spec;
+    char *end;
+
+    memset(rule, 0, sizeof(*rule));
+    strncpy(rule->name, name, sizeof(rule->name) - 1);
+    rule->tone = tone;
+    rule->cycles = cycles > 0 ? cycles : 1;
+
+    if (!p || !*p) {
+        return -1;
+    }
+
+    while (*p) {
+        unsigned long lo, hi;
+
+        if (rule->nseg >= RINGBACK_CADENCE_MAX_SEGMENTS) {
+            return -1;
+        }
+        lo = strtoul(p, &end, 10);
+        if (end == p) {
+            return -1;
+        }
+        hi = lo;
+        p = end;
+        if (*p == '-') {
+            p++;
+            hi = strtoul(p, &end, 10);
+            if (end == p) {
+                return -1;
+            }
+            p = end;
+        }
+        if (hi < lo) {
+            return -1;
+        }
+        rule->min_ms[rule->nseg] = (uint32_t)lo;
+        rule->max_ms[rule->nseg] = (uint32_t)hi;
+        rule->nseg++;
+
+        if (*p == '|') {
+            p++;
+        } else if (*p) {
+            return -1;
+        }
+    }
+
+    /* 只给了响段：补一个任意长度的停段 */
+    if (rule->nseg & 1) {
+        if (rule->nseg >= RINGBACK_CADENCE_MAX_SEGMENTS) {
+            return -1;
+        }
+        rule->min_ms[rule->nseg] = 0;
+        rule->max_ms[rule->nseg] = UINT32_MAX;
+        rule->nseg++;
+    }
+
+    return 0;
+}
+
+int ringback_cadence_compile(ringback_cadence_t *c, const ringback_cadence_rule_t *rules, int nrules)
+{
+    int r, j, b;
+
+    if (nrules < 0 || nrules > RINGBACK_CADENCE_MAX_RULES) {
+        return -1;
+    }
+
+    memset(c, 0, sizeof(*c));
+
+    for (r = 0; r < nrules; r++) {
+        const ringback_cadence_rule_t *rule = &rules[r];
+        int unrolled = rule->nseg * rule->cycles;
+
+        if (rule->nseg <= 0 || (rule->nseg & 1) || rule->cycles <= 0 || unrolled > 32) {
+            return -1;
+        }
+
+        /* 展开位置 j 对应周期内第 j % nseg 段，偶数段为响 */
+        for (j = 0; j < unrolled; j++) {
+            int seg = j % rule->nseg;
+            int on = !(seg & 1);
+
+            for (b = 0; b < RINGBACK_CADENCE_BUCKETS; b++) {
+                uint32_t lo = (uint32_t)b * RINGBACK_CADENCE_BUCKET_MS;
+                uint32_t hi = b == RINGBACK_CADENCE_BUCKETS - 1 ? UINT32_MAX : lo + RINGBACK_CADENCE_BUCKET_MS - 1;
+
+                if (rule->min_ms[seg] <= hi && rule->max_ms[seg] >= lo) {
+                    c->accept[on][b][r] |= 1u << j;
+                }
+            }
+        }
+
+        c->rules[r] = *rule;
+        c->final[r] = 1u << (unrolled - 1);
+    }
+
+    c->nrules = nrules;
+    return 0;
+}
+
+void ringback_cadence_reset(ringback_cadence_state_t *st)
+{
+    memset(st, 0, sizeof(*st));
+}
+
+int ringback_cadence_step_mask(const ringback_cadence_t *c, ringback_cadence_state_t *st, uint64_t mask,
+                               int on, uint32_t dur_ms)
+{
+    uint32_t b = dur_ms / RINGBACK_CADENCE_BUCKET_MS;
+    const uint32_t *accept;
+    int matched = -1;
+
+    if (b >= RINGBACK_CADENCE_BUCKETS) {
+        b = RINGBACK_CADENCE_BUCKETS - 1;
+    }
+    accept = c->accept[on ? 1 : 0][b];
+
+    if (c->nrules < 64) {
+        mask &= (UINT64_C(1) << c->nrules) - 1;
+    }
+    while (mask) {
+        int r = __builtin_ctzll(mask);
+        mask &= mask - 1;
+        st->active[r] = ((st->active[r] << 1) | 1u) & accept[r];
+        if (matched < 0 && (st->active[r] & c->final[r])) {
+            matched = r;
+        }
+    }
+
+    return matched;
+}
+
+int ringback_cadence_step(const ringback_cadence_t *c, ringback_cadence_state_t *st, int on, uint32_t dur_ms)
+{
+    return ringback_cadence_step_mask(c, st, ~UINT64_C(0), on, dur_ms);
+}
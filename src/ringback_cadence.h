@@ -0,0 +1,74 @@
+/*
+ * ringback_cadence - 信号音时序自动机
+ *
+ * 规则为响/停交替的若干段 (从"响"开始)，每段一个时长范围，例如
+ *   忙音            "300-400|250-400"
+ *   英国双振铃回铃音 "350-450|150-250|350-450|1800-2200"
+ * 规则连续出现 cycles 个周期即判定匹配。
+ *
+ * 编译时把每条规则按周期展开 (最多 32 段)，并把每个时长分桶预先算出
+ * "可接受该段的展开位置"位图；运行时每个响/停段对每条规则只做一次查表
+ * 和一次移位与 (Shift-And)，与已观察的段数和模式长度无关。
+ * 从任意相位开始检测 (如中途接入双振铃) 都能在下一个完整周期对齐。
+ *
+ * 不依赖 FreeSWITCH，可单独编译测试。
+ */
+
+#ifndef RINGBACK_CADENCE_H
+#define RINGBACK_CADENCE_H
+
+#include <stdint.h>
+
+#define RINGBACK_CADENCE_MAX_SEGMENTS 8     /* 单周期最多段数 */
+#define RINGBACK_CADENCE_MAX_RULES    64    /* 规则位图为 uint64_t */
+#define RINGBACK_CADENCE_BUCKET_MS    10    /* 时长分桶粒度 */
+#define RINGBACK_CADENCE_MAX_MS       10000 /* 更长的段并入最后一桶 */
+#define RINGBACK_CADENCE_BUCKETS      (RINGBACK_CADENCE_MAX_MS / RINGBACK_CADENCE_BUCKET_MS + 1)
+#define RINGBACK_CADENCE_NAME_LEN     32
+
+typedef struct ringback_cadence_rule {
+    char name[RINGBACK_CADENCE_NAME_LEN];
+    int tone;               /* 匹配后报告的信号类型，由调用方定义 */
+    int nseg;               /* 段数，偶数 (响/停成对) */
+    uint32_t min_ms[RINGBACK_CADENCE_MAX_SEGMENTS];
+    uint32_t max_ms[RINGBACK_CADENCE_MAX_SEGMENTS];
+    int cycles;             /* 需要连续出现的周期数 */
+} ringback_cadence_rule_t;
+
+/*
+ * 解析 "min-max|min-max|..." 形式的规则，单个数值表示 min=max。
+ * 段数为奇数时补一个任意长度的"停"段。成功返回 0，格式错误返回 -1
+ */
+int ringback_cadence_parse(ringback_cadence_rule_t *rule, const char *name, int tone,
+                           const char *spec, int cycles);
+
+/* 编译后的规则表，只读，可被多路通道共享 */
+typedef struct ringback_cadence {
+    int nrules;
+    ringback_cadence_rule_t rules[RINGBACK_CADENCE_MAX_RULES];
+    /* [停/响][时长桶][规则]：一次查表的各规则位图在同一段连续内存 */
+    uint32_t accept[2][RINGBACK_CADENCE_BUCKETS][RINGBACK_CADENCE_MAX_RULES];
+    uint32_t final[RINGBACK_CADENCE_MAX_RULES];                                /* 最后一段对应的位 */
+} ringback_cadence_t;
+
+/* 编译规则表，规则越靠前优先级越高。规则过多或展开后超过 32 段返回 -1 */
+int ringback_cadence_compile(ringback_cadence_t *c, const ringback_cadence_rule_t *rules, int nrules);
+
+/* 每路通道的匹配状态 */
+typedef struct ringback_cadence_state {
+    uint32_t active[RINGBACK_CADENCE_MAX_RULES];
+} ringback_cadence_state_t;
+
+void ringback_cadence_reset(ringback_cadence_state_t *st);
+
+/*
+ * 喂入一个已结束的段 (on=1 响，on=0 停) 及其时长，
+ * 返回本段完成匹配的最高优先级规则下标，无匹配返回 -1
+ */
+int ringback_cadence_step(const ringback_cadence_t *c, ringback_cadence_state_t *st, int on, uint32_t dur_ms);
+
+/* 同上，只推进 mask 中的规则 (第 r 位对应规则 r)，其余规则状态不变 */
+int ringback_cadence_step_mask(const ringback_cadence_t *c, ringback_cadence_state_t *st, uint64_t mask,
+                               int on, uint32_t dur_ms);
+
+#endif /* RINGBACK_CADENCE_H */
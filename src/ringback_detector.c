@@ -0,0 +1,367 @@
+/*
+ * ringback_detector - 单通道信号音检测器实现
+ */
+
+#include "ringback_detector.h"
+#include "ringback_probes.h"
+
+#include <math.h>
+#include <string.h>
+
+const double ringback_default_freqs[RINGBACK_DEFAULT_NBINS] = {
+    350.0, 400.0, 425.0, 440.0, 450.0, 480.0, 620.0,
+    913.8, 985.2, 1370.6, 1428.5, 1776.7,
+    800.0, 850.0, 880.0, 960.0
+};
+
+/* ringback:edge (标识, 频率特征下标, 1 起音/0 停音, 边沿时刻 ms, 刚结束的段时长 ms, 本块 RMS) */
+RINGBACK_PROBE_SEMAPHORE(edge);
+
+int ringback_detector_init(ringback_detector_t *d, const ringback_bank_t *bank, int in_rate)
+{
+    memset(d, 0, sizeof(*d));
+    d->bank = bank;
+    d->rule = -1;
+    ringback_tonetrack_reset(&d->track);
+    return ringback_detector_set_rate(d, in_rate);
+}
+
+/*
+ * 按输入采样率配置分析链路：
+ * - 8kHz 直接分析
+ * - 8kHz 整数倍 (16k/24k/32k/48k...) 多相抽取到 8kHz
+ * - 其他采样率按该采样率重新计算滤波器组系数，块长保持 20ms
+ * 已累计的分析时长换算到新采样率下保留
+ * 采样率过低 (一个分析块不足 1 个样本) 时返回 -1，原有配置不变
+ */
+int ringback_detector_set_rate(ringback_detector_t *d, int in_rate)
+{
+    uint64_t elapsed_ms = d->rate ? d->stream.samples * 1000 / d->rate : 0;
+
+    if (in_rate <= 0 || (int64_t)in_rate * RINGBACK_DETECTOR_BLOCK < RINGBACK_DETECTOR_RATE) {
+        return -1;
+    }
+
+    d->in_rate = in_rate;
+    memset(&d->decim, 0, sizeof(d->decim));
+
+    if (in_rate == RINGBACK_DETECTOR_RATE || ringback_decim_init(&d->decim, in_rate, RINGBACK_DETECTOR_RATE) == 0) {
+        d->rate = RINGBACK_DETECTOR_RATE;
+        ringback_stream_init(&d->stream, d->bank, RINGBACK_DETECTOR_BLOCK);
+    } else {
+        ringback_bank_t bank;
+        d->rate = in_rate;
+        ringback_bank_init(&bank, d->bank->freq, d->bank->nbins, in_rate);
+        ringback_stream_init(&d->stream, &bank, in_rate * RINGBACK_DETECTOR_BLOCK / RINGBACK_DETECTOR_RATE);
+    }
+
+    d->stream.samples = elapsed_ms * d->rate / 1000;
+    return 0;
+}
+
+void ringback_detector_set_rules(ringback_detector_t *d, uint64_t rules, int energy_threshold)
+{
+    d->rules = rules;
+    d->energy_threshold = energy_threshold;
+    ringback_tonetrack_reset(&d->track);
+}
+
+int ringback_detector_poll(ringback_detector_t *d, ringback_verdict_t *v)
+{
+    if (!d->nverdicts) {
+        return 0;
+    }
+    *v = d->verdicts[0];
+    d->nverdicts--;
+    memmove(d->verdicts, d->verdicts + 1, d->nverdicts * sizeof(d->verdicts[0]));
+    return 1;
+}
+
+/*
+ * 所有时长由样本时钟推算 (累计分析样本数)，不读墙钟，不受抖动缓冲突发影响。
+ * RTP 序号跳变说明中间有丢包：按时间戳差把缺失的时长补进样本时钟，
+ * 乱序/重复包不更新基准
+ */
+static void account_rtp_gap(ringback_detector_t *d, const ringback_detector_frame_t *f, int in_samples, int in_rate)
+{
+    uint16_t dseq;
+    uint32_t dts;
+
+    if (f->seq == 0 && f->timestamp == 0) {
+        return;
+    }
+
+    if (d->rtp_valid) {
+        dseq = (uint16_t)(f->seq - d->rtp_seq);
+        if (dseq == 0 || dseq >= 0x8000) {
+            return;
+        }
+        dts = f->timestamp - d->rtp_ts;
+        if (dseq > 1 && dts > d->rtp_samples &&
+            dts - d->rtp_samples <= (uint32_t)in_rate / 1000 * RINGBACK_RTP_MAX_GAP_MS) {
+            ringback_stream_skip(&d->stream, (uint64_t)(dts - d->rtp_samples) * d->rate / in_rate);
+        }
+    }
+
+    d->rtp_valid = 1;
+    d->rtp_seq = f->seq;
+    d->rtp_ts = f->timestamp;
+    d->rtp_samples = in_samples;
+}
+
+/* 样本位置换算为分析时刻 (毫秒) */
+static uint32_t stream_ms(const ringback_detector_t *d, uint64_t sample)
+{
+    return (uint32_t)(sample * 1000 / d->rate);
+}
+
+/*
+ * 监视模式下的一帧：样本时钟照常推进，每 monitor_interval 帧才算一次分段平方和
+ * (samples 为 NULL 表示静音帧)。电平或节奏偏离判定时的信号即回到完整分析，
+ * 时序状态从头匹配
+ */
+static void monitor_frame(ringback_detector_t *d, const int16_t *samples, int count, uint32_t now_ms)
+{
+    uint64_t seg[RINGBACK_MONITOR_SEGS] = { 0 };
+    int i, n = count / RINGBACK_MONITOR_SEGS;
+
+    if (++d->monitor_frames < d->monitor_interval) {
+        return;
+    }
+    d->monitor_frames = 0;
+
+    if (samples) {
+        for (i = 0; i < RINGBACK_MONITOR_SEGS; i++) {
+            seg[i] = ringback_energy_sumsq(samples + i * n, n);
+        }
+    }
+    if (ringback_monitor_check(&d->monitor, seg, n * RINGBACK_MONITOR_SEGS, now_ms)) {
+        ringback_tonetrack_reset(&d->track);
+        ringback_trace_monitor(&d->trace, now_ms, 0);
+    }
+}
+
+/* 时序规则命中：记录判定，属于 stoptones 时结束检测，否则转入监视 */
+static int rule_matched(ringback_detector_t *d, const ringback_toneset_t *ts, int r, uint32_t now_ms)
+{
+    const ringback_cadence_rule_t *rule = &ts->rules[r];
+    ringback_verdict_t *v;
+
+    if (d->nverdicts == RINGBACK_DETECTOR_VERDICTS) {
+        d->nverdicts--;
+    }
+    v = &d->verdicts[d->nverdicts++];
+    v->rule = r;
+    v->tone = rule->tone;
+    v->ms = now_ms;
+    v->confidence = d->track.confidence;
+    v->first = !d->decision_ms;
+    v->stop = (d->stoptones & rule->tone) != 0;
+
+    d->tone = rule->tone;
+    d->rule = r;
+    if (v->first) {
+        d->decision_ms = now_ms ? now_ms : 1;
+        d->confidence = d->track.confidence;
+    }
+    ringback_trace_rule(&d->trace, now_ms, r, rule->tone, d->track.confidence);
+
+    if (v->stop) {
+        d->finished = 1;
+        d->monitor.active = 0;
+        return RINGBACK_DETECT_STOP;
+    }
+
+    /* 继续检测，但只做低开销监视，直到信号变化 */
+    if (d->monitor_interval > 0 && !d->monitor.active &&
+        ringback_monitor_start(&d->monitor, ts, &d->track, r, now_ms) == 0) {
+        d->monitor_frames = 0;
+        ringback_trace_monitor(&d->trace, now_ms, 1);
+    }
+    return RINGBACK_DETECT_VERDICT;
+}
+
+/*
+ * 处理一个分析块：更新各频率特征的响/停状态并做时序匹配，now_ms 为块结束时刻。
+ * 跟踪或 edge 探针打开时比较块前后的响停状态，记录边沿
+ */
+static int process_block(ringback_detector_t *d, const ringback_toneset_t *ts, const ringback_block_t *blk,
+                         uint32_t now_ms)
+{
+    int in_tone[RINGBACK_TONESET_MAX_SIGS];
+    int probe = RINGBACK_PROBE_ENABLED(edge) || d->trace.size;
+    int i, r;
+
+    if (probe) {
+        for (i = 0; i < ts->nsig; i++) {
+            in_tone[i] = d->track.sig[i].in_tone;
+        }
+    }
+
+    /* 各候选方案的频率特征共用本块的能量和频点功率，分别切分响/停段 */
+    r = ringback_tonetrack_block(ts, &d->track, d->rules, blk, d->energy_threshold, now_ms);
+
+    if (probe) {
+        uint16_t on = 0;
+        for (i = 0; i < ts->nsig; i++) {
+            on |= (uint16_t)((d->track.sig[i].in_tone != 0) << i);
+        }
+        ringback_trace_block(&d->trace, now_ms, blk->sumsq, blk->count, blk->power, ts->nbins, on);
+        for (i = 0; i < ts->nsig; i++) {
+            const ringback_sigtrack_t *sig = &d->track.sig[i];
+            if (sig->in_tone != in_tone[i]) {
+                uint32_t edge_ms = sig->in_tone ? sig->tone_start_ms : sig->silence_start_ms;
+                uint32_t start_ms = sig->in_tone ? sig->silence_start_ms : sig->tone_start_ms;
+                ringback_trace_edge(&d->trace, edge_ms, i, sig->in_tone, edge_ms - start_ms);
+                RINGBACK_PROBE6(edge, d->tag ? d->tag : "", i, sig->in_tone, edge_ms, edge_ms - start_ms,
+                                blk->count ? (int)sqrt((double)blk->sumsq / blk->count) : 0);
+            }
+        }
+    }
+
+    return r >= 0 ? rule_matched(d, ts, r, now_ms) : RINGBACK_DETECT_CONTINUE;
+}
+
+/*
+ * 舒适噪声帧没有可分析的 PCM：推进时钟并按一个静音块处理。
+ * 对端 VAD 的长静音因此切出停段，丢包补偿这类短于 min_gap_ms 的 CNG 则在响段中被桥接
+ */
+static int feed_cng(ringback_detector_t *d, const ringback_toneset_t *ts, const ringback_detector_frame_t *f)
+{
+    uint32_t in_samples = f->samples ? f->samples : d->rtp_samples ? d->rtp_samples : (uint32_t)d->in_rate / 50;
+    ringback_block_t blk;
+    uint32_t now_ms;
+
+    account_rtp_gap(d, f, in_samples, d->in_rate);
+    memset(&blk, 0, sizeof(blk));
+    blk.count = (int)((uint64_t)in_samples * d->rate / d->in_rate);
+    ringback_stream_skip(&d->stream, blk.count);
+    blk.end_sample = d->stream.samples;
+    now_ms = stream_ms(d, blk.end_sample);
+
+    if (d->monitor.active) {
+        monitor_frame(d, NULL, blk.count, now_ms);
+        return RINGBACK_DETECT_CONTINUE;
+    }
+    return process_block(d, ts, &blk, now_ms);
+}
+
+/*
+ * 分析帧中的一段：L16 抽取后、G.711 解码后都不超过 RINGBACK_BATCH_MAX_SAMPLES 个样本。
+ * 完成的块写入 blocks，返回块数
+ */
+static int feed_chunk(ringback_detector_t *d, const void *data, int count, int native, ringback_block_t *blocks)
+{
+    const int16_t *samples = (const int16_t *)data;
+    int16_t linear[RINGBACK_BATCH_MAX_SAMPLES];
+    int nblocks, i;
+    uint64_t end;
+
+    if (!native && d->decim.factor > 1) {
+        /* 宽带输入抽取到 8kHz */
+        count = ringback_decim_process(&d->decim, samples, count, linear);
+        samples = linear;
+    }
+
+    if (d->block_fn && d->rate == RINGBACK_DETECTOR_RATE) {
+        /* 外部算块：只收线性样本，先解码；结果可能滞后，最后一块的块末时刻取本帧末尾，之前的依次前推 */
+        d->stream.samples += count;
+        if (native) {
+            ringback_g711_decode((const uint8_t *)data, linear, count, d->g711_law);
+            samples = linear;
+        }
+        nblocks = d->block_fn(d->block_arg, samples, count, blocks);
+        for (i = nblocks - 1, end = d->stream.samples; i >= 0; i--) {
+            blocks[i].end_sample = end;
+            end = end > (uint64_t)blocks[i].count ? end - blocks[i].count : 0;
+        }
+    } else if (native) {
+        /* 能量与滤波器组同一遍完成；不足一块的样本留待下一帧续接 */
+        nblocks = ringback_stream_feed_g711(&d->stream, d->g711_law, (const uint8_t *)data, count,
+                                            blocks, RINGBACK_STREAM_MAX_BLOCKS);
+    } else {
+        nblocks = ringback_stream_feed(&d->stream, samples, count, blocks, RINGBACK_STREAM_MAX_BLOCKS);
+    }
+    return nblocks;
+}
+
+int ringback_detector_feed(ringback_detector_t *d, const ringback_toneset_t *ts, const ringback_detector_frame_t *f)
+{
+    const int16_t *samples = (const int16_t *)f->data;
+    int16_t linear[RINGBACK_BATCH_MAX_SAMPLES];
+    ringback_block_t blocks[RINGBACK_STREAM_MAX_BLOCKS];
+    int samples_per_frame, native, nblocks, ret = RINGBACK_DETECT_CONTINUE, step, off, i;
+
+    if (d->finished) {
+        return RINGBACK_DETECT_STOP;
+    }
+    /* 未配置有效采样率 (init/set_rate 失败) 时不分析 */
+    if (d->in_rate <= 0) {
+        return RINGBACK_DETECT_CONTINUE;
+    }
+    if (f->cng) {
+        return feed_cng(d, ts, f);
+    }
+
+    /* 帧为未解码的 G.711 (每样本 1 字节) 时直接查表分析，否则按 L16 处理 */
+    native = d->g711_law != RINGBACK_G711_NONE && f->samples > 0 && f->datalen == f->samples;
+    samples_per_frame = native ? (int)f->datalen : (int)(f->datalen / 2);
+    if (samples_per_frame <= 0) {
+        return RINGBACK_DETECT_CONTINUE;
+    }
+
+    /* 输入采样率变化 (如 re-INVITE 换编码) 时重新配置 */
+    if (!native && f->rate > 0 && (int)f->rate != d->in_rate) {
+        ringback_detector_set_rate(d, f->rate);
+    }
+
+    account_rtp_gap(d, f, samples_per_frame, native ? RINGBACK_DETECTOR_RATE : d->in_rate);
+
+    if (d->monitor.active) {
+        /* 监视模式不跑滤波器组，电平按输入采样率计算即可 */
+        int in_rate = native ? RINGBACK_DETECTOR_RATE : d->in_rate;
+        ringback_stream_skip(&d->stream, (uint64_t)samples_per_frame * d->rate / in_rate);
+        if (native) {
+            /* 样本时钟已按整帧推进；超过解码缓冲的长帧取最近 60ms 计算电平 */
+            const uint8_t *g711 = (const uint8_t *)f->data;
+            if (samples_per_frame > RINGBACK_BATCH_MAX_SAMPLES) {
+                g711 += samples_per_frame - RINGBACK_BATCH_MAX_SAMPLES;
+                samples_per_frame = RINGBACK_BATCH_MAX_SAMPLES;
+            }
+            if (d->monitor_frames + 1 >= d->monitor_interval) {
+                ringback_g711_decode(g711, linear, samples_per_frame, d->g711_law);
+            }
+            samples = linear;
+        }
+        monitor_frame(d, samples, samples_per_frame, stream_ms(d, d->stream.samples));
+        return RINGBACK_DETECT_CONTINUE;
+    }
+
+    /* 批处理每轮每槽位最多 RINGBACK_BATCH_MAX_SAMPLES 个样本，更长的帧 (如 120ms ptime) 改为逐通道计算 */
+    if (d->block_fn && (native || d->decim.factor <= 1 ? samples_per_frame : samples_per_frame / d->decim.factor) >
+                       RINGBACK_BATCH_MAX_SAMPLES) {
+        d->block_fn = NULL;
+    }
+
+    /* 按抽取/解码缓冲的容量分段分析，整帧都计入样本时钟 */
+    step = RINGBACK_BATCH_MAX_SAMPLES * (!native && d->decim.factor > 1 ? d->decim.factor : 1);
+    for (off = 0; off < samples_per_frame; off += step) {
+        int n = samples_per_frame - off < step ? samples_per_frame - off : step;
+
+        nblocks = feed_chunk(d, native ? (const void *)((const uint8_t *)f->data + off) : (const void *)(samples + off),
+                             n, native, blocks);
+
+        /* 按顺序把完成的块交给时序逻辑，块末时刻由其结束样本位置确定 */
+        for (i = 0; i < nblocks; i++) {
+            int r = process_block(d, ts, &blocks[i], stream_ms(d, blocks[i].end_sample));
+            if (r == RINGBACK_DETECT_STOP) {
+                return r;
+            }
+            if (r > ret) {
+                ret = r;
+            }
+        }
+    }
+
+    return ret;
+}
@@ -0,0 +1,137 @@
+/*
+ * ringback_detector - 单通道信号音检测器
+ *
+ * 把一路媒体从帧到判定的全部分析串起来：采样率适配 (多相抽取或按原采样率重算滤波器组)、
+ * PCMU/PCMA 原始载荷直接分析、RTP 丢包补时、CNG 帧、滤波器组分块、多方案响停跟踪与
+ * 时序匹配、判定后的低开销监视和判定跟踪。模块只是它的 FreeSWITCH 适配层，
+ * 单元测试、基准和离线工具走的是同一条生产代码路径。
+ *
+ * 用法：ringback_detector_init 后设定 rules/energy_threshold/stoptones/monitor_interval
+ * (ringback_detector_set_rules)，逐帧 ringback_detector_feed，返回值不为
+ * RINGBACK_DETECT_CONTINUE 时用 ringback_detector_poll 取出本帧的判定。
+ * 配置 (toneset) 由调用方每次传入，可以在帧之间替换快照。
+ *
+ * 单线程使用 (同一时刻只有一个线程 feed)。
+ *
+ * 不依赖 FreeSWITCH，可单独编译测试。
+ */
+
+#ifndef RINGBACK_DETECTOR_H
+#define RINGBACK_DETECTOR_H
+
+#include <stdint.h>
+
+#include "ringback_dsp.h"
+#include "ringback_tones.h"
+#include "ringback_trace.h"
+
+#define RINGBACK_DETECTOR_RATE     8000     /* 分析采样率 */
+#define RINGBACK_DETECTOR_BLOCK    160      /* 20ms @ 8kHz，块跨帧续接，10/20/30/60ms 打包均无样本丢弃 */
+#define RINGBACK_DETECTOR_VERDICTS 4        /* 一帧内最多暂存的判定 */
+#define RINGBACK_RTP_MAX_GAP_MS    2000     /* RTP 时间戳跳变超过此值视为流重置，不计入样本时钟 */
+
+/*
+ * 滤波器组频点 (Hz)：各国回铃/忙音常用单频和双频分量 (覆盖 ringback_tones 内置方案)，
+ * SIT 特殊信息音，以及常用单频的二次谐波 (800/850/880/960，450Hz 的由 913.8 覆盖)
+ * 用于谐波校验。增加频点几乎不增加开销 (SIMD 每条指令处理 4/8 个频点)。
+ */
+#define RINGBACK_DEFAULT_NBINS 16
+extern const double ringback_default_freqs[RINGBACK_DEFAULT_NBINS];
+
+/* 内置缺省规则 (响ms|停ms) 和能量门限，与 ringback.conf.xml 默认值一致 */
+#define RINGBACK_DEFAULT_BUSY_RULE       "300-400|250-400"
+#define RINGBACK_DEFAULT_RINGBACK_RULE   "900-1100|3000-4500"
+#define RINGBACK_DEFAULT_CONGESTION_RULE "600-750|500-750"
+#define RINGBACK_DEFAULT_TONE_FREQ       "450"     /* 上述规则的信号音频率，置空只按能量判断 */
+#define RINGBACK_DEFAULT_ENERGY          200       /* 绝对能量下限 RMS (约 -38dBm0)，起音还需高于噪声基底 */
+
+enum {
+    RINGBACK_DETECT_CONTINUE,   /* 无新判定 */
+    RINGBACK_DETECT_VERDICT,    /* 有新判定 (不在 stoptones 中)，检测继续 */
+    RINGBACK_DETECT_STOP        /* 命中 stoptones，检测结束，之后的帧不再分析 */
+};
+
+typedef struct ringback_detector_frame {
+    const void *data;           /* L16 样本或 G.711 载荷 (g711_law 非 NONE 且 datalen == samples) */
+    uint32_t datalen;
+    uint32_t samples;
+    uint32_t rate;              /* 0 表示沿用当前输入采样率 */
+    uint32_t timestamp;         /* RTP 时间戳，与 seq 同为 0 表示无 RTP 信息 */
+    uint16_t seq;
+    int cng;                    /* 舒适噪声帧，可不带载荷 */
+} ringback_detector_frame_t;
+
+typedef struct ringback_verdict {
+    int rule;                   /* 规则下标 (调用 feed 时传入的 toneset) */
+    int tone;                   /* RINGBACK_TONE_* */
+    uint32_t ms;                /* 命中时刻 (检测开始起) */
+    float confidence;           /* 完整匹配为 1 */
+    int first;                  /* 本次检测的首次判定 */
+    int stop;                   /* 属于 stoptones */
+} ringback_verdict_t;
+
+/*
+ * 外部算块 (如跨通道批处理引擎)：收下 count 个 8kHz 线性样本，
+ * 把已完成的块按时间顺序写入 out 并返回块数 (最多 RINGBACK_STREAM_MAX_BLOCKS 个)
+ */
+typedef int (*ringback_detector_block_fn)(void *arg, const int16_t *samples, int count, ringback_block_t *out);
+
+typedef struct ringback_detector {
+    const ringback_bank_t *bank;    /* 8kHz 滤波器组模板，其他采样率按其频点重算 */
+    ringback_stream_t stream;
+    int in_rate;                /* 输入采样率 */
+    int rate;                   /* 分析采样率：RINGBACK_DETECTOR_RATE，非整数倍率时等于 in_rate */
+    ringback_decim_t decim;     /* factor 为 0 表示无需抽取 */
+    int g711_law;               /* 输入为 PCMU/PCMA 原始载荷时直接查表分析 */
+
+    int rtp_valid;              /* 已收到带 RTP 序号/时间戳的帧 */
+    uint16_t rtp_seq;
+    uint32_t rtp_ts;
+    uint32_t rtp_samples;       /* 上一帧样本数 (RTP 时钟) */
+
+    ringback_tonetrack_t track;
+    uint64_t rules;             /* 参与匹配的规则位图 */
+    int energy_threshold;
+    int stoptones;              /* 命中这些信号 (RINGBACK_TONE_*) 时结束 */
+
+    ringback_monitor_t monitor; /* 判定后的低开销监视 */
+    int monitor_interval;       /* 每隔多少帧检查一次，0 关闭监视 */
+    int monitor_frames;
+
+    int finished;
+    int tone;                   /* 最近一次判定的信号类型，0 表示未判定 */
+    int rule;                   /* 最近一次判定的规则下标，-1 表示未判定 */
+    uint32_t decision_ms;       /* 首次判定时刻，0 表示尚未判定 */
+    float confidence;           /* 首次判定的置信度 */
+    ringback_verdict_t verdicts[RINGBACK_DETECTOR_VERDICTS];
+    int nverdicts;
+
+    ringback_detector_block_fn block_fn;    /* 非 NULL 时 8kHz 输入交给它算块 */
+    void *block_arg;
+
+    ringback_trace_t trace;     /* 判定跟踪，size 为 0 表示关闭 */
+    const char *tag;            /* USDT 探针中的通道标识 (如 UUID) */
+} ringback_detector_t;
+
+/* bank 为 8kHz 滤波器组模板 (调用方保证生命期)，in_rate 为输入采样率；采样率无效返回 -1 */
+int ringback_detector_init(ringback_detector_t *d, const ringback_bank_t *bank, int in_rate);
+
+/* 输入采样率变化时重新配置分析链路，已累计的分析时长保留；采样率无效返回 -1，配置不变 */
+int ringback_detector_set_rate(ringback_detector_t *d, int in_rate);
+
+/* 设定参与匹配的规则和能量门限，时序状态从头匹配 */
+void ringback_detector_set_rules(ringback_detector_t *d, uint64_t rules, int energy_threshold);
+
+/* 分析一帧，返回 RINGBACK_DETECT_* */
+int ringback_detector_feed(ringback_detector_t *d, const ringback_toneset_t *ts, const ringback_detector_frame_t *f);
+
+/* 按时间顺序取出一条判定，没有时返回 0 */
+int ringback_detector_poll(ringback_detector_t *d, ringback_verdict_t *v);
+
+/* 当前分析时刻 (毫秒，由样本时钟推算) */
+static inline uint32_t ringback_detector_ms(const ringback_detector_t *d)
+{
+    return (uint32_t)(d->stream.samples * 1000 / d->rate);
+}
+
+#endif /* RINGBACK_DETECTOR_H */
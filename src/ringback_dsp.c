@@ -0,0 +1,1138 @@
+/*
+ * ringback_dsp - 回铃音识别 DSP 内核实现
+ */
+#include "ringback_dsp.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define RINGBACK_DSP_X86 1
+#include <immintrin.h>
+#endif
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+int32_t ringback_goertzel_coef(double freq, int rate)
+{
+    double coef = 2.0 * cos(2.0 * M_PI * freq / rate);
+    return (int32_t)lrint(coef * (1 << RINGBACK_COEF_Q));
+}
+
+void ringback_goertzel_init(ringback_goertzel_t *g, double freq, int rate)
+{
+    memset(g, 0, sizeof(*g));
+    g->coef = ringback_goertzel_coef(freq, rate);
+}
+
+void ringback_goertzel_reset(ringback_goertzel_t *g)
+{
+    g->s1 = g->s2 = 0;
+    g->count = 0;
+}
+
+uint64_t ringback_fused_process(ringback_goertzel_t *g, const int16_t *samples, int count)
+{
+    int64_t coef = g->coef;
+    int32_t s1 = g->s1, s2 = g->s2;
+    uint64_t sumsq = 0;
+    int i;
+
+    for (i = 0; i < count; i++) {
+        int32_t x = samples[i];
+        int32_t s0 = x + (int32_t)((coef * s1) >> RINGBACK_COEF_Q) - s2;
+        sumsq += (uint32_t)(x * x);
+        s2 = s1;
+        s1 = s0;
+    }
+
+    g->s1 = s1;
+    g->s2 = s2;
+    g->count += count;
+    return sumsq;
+}
+
+uint64_t ringback_energy_sumsq(const int16_t *samples, int count)
+{
+    uint64_t sumsq = 0;
+    int i;
+    for (i = 0; i < count; i++) {
+        int32_t x = samples[i];
+        sumsq += (uint32_t)(x * x);
+    }
+    return sumsq;
+}
+
+/* 单频点 Goertzel 功率 |X(k)|^2 */
+static inline int64_t bin_power(int32_t coef, int32_t s1_, int32_t s2_)
+{
+    int64_t s1 = s1_, s2 = s2_;
+    return s1 * s1 + s2 * s2 - (((int64_t)coef * s1) >> RINGBACK_COEF_Q) * s2;
+}
+
+int64_t ringback_goertzel_power(const ringback_goertzel_t *g)
+{
+    return bin_power(g->coef, g->s1, g->s2);
+}
+
+int ringback_bank_init(ringback_bank_t *b, const double *freqs, int nbins, int rate)
+{
+    int i;
+
+    if (nbins < 0 || nbins > RINGBACK_BANK_MAX_BINS) {
+        return -1;
+    }
+
+    memset(b, 0, sizeof(*b));
+    for (i = 0; i < nbins; i++) {
+        b->freq[i] = freqs[i];
+        b->coef[i] = ringback_goertzel_coef(freqs[i], rate);
+    }
+    b->nbins = nbins;
+    return 0;
+}
+
+void ringback_bank_reset(ringback_bank_t *b)
+{
+    memset(b->s1, 0, sizeof(b->s1));
+    memset(b->s2, 0, sizeof(b->s2));
+    b->count = 0;
+}
+
+int ringback_bank_find(const ringback_bank_t *b, double freq)
+{
+    int i;
+    for (i = 0; i < b->nbins; i++) {
+        if (fabs(b->freq[i] - freq) < 0.5) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void ringback_bank_powers(const ringback_bank_t *b, int64_t *out)
+{
+    int i;
+    for (i = 0; i < b->nbins; i++) {
+        out[i] = bin_power(b->coef[i], b->s1[i], b->s2[i]);
+    }
+}
+
+/* 标量内核：逐频点递推，平方和只算一次 */
+static uint64_t bank_process_scalar(ringback_bank_t *b, const int16_t *samples, int count)
+{
+    uint64_t sumsq = ringback_energy_sumsq(samples, count);
+    int k, i;
+
+    for (k = 0; k < b->nbins; k++) {
+        int64_t coef = b->coef[k];
+        int32_t s1 = b->s1[k], s2 = b->s2[k];
+        for (i = 0; i < count; i++) {
+            int32_t s0 = samples[i] + (int32_t)((coef * s1) >> RINGBACK_COEF_Q) - s2;
+            s2 = s1;
+            s1 = s0;
+        }
+        b->s1[k] = s1;
+        b->s2[k] = s2;
+    }
+
+    b->count += count;
+    return sumsq;
+}
+
+/* 标量批处理内核：逐频点、逐通道递推 */
+static void batch_process_scalar(const int16_t *x, int n, const int32_t *coef, int nbins,
+                                 int32_t *s1out, int32_t *s2out)
+{
+    int k, i, l;
+
+    for (k = 0; k < nbins; k++) {
+        int32_t s1[RINGBACK_BATCH_LANES] = { 0 }, s2[RINGBACK_BATCH_LANES] = { 0 };
+        int64_t c = coef[k];
+        for (i = 0; i < n; i++) {
+            const int16_t *xi = x + i * RINGBACK_BATCH_LANES;
+            for (l = 0; l < RINGBACK_BATCH_LANES; l++) {
+                int32_t s0 = xi[l] + (int32_t)((c * s1[l]) >> RINGBACK_COEF_Q) - s2[l];
+                s2[l] = s1[l];
+                s1[l] = s0;
+            }
+        }
+        memcpy(s1out + k * RINGBACK_BATCH_LANES, s1, sizeof(s1));
+        memcpy(s2out + k * RINGBACK_BATCH_LANES, s2, sizeof(s2));
+    }
+}
+
+int16_t ringback_ulaw_table[256];
+int16_t ringback_alaw_table[256];
+
+/* G.711 解码表，ringback_dsp_init 中生成 */
+static void g711_tables_init(void)
+{
+    int i;
+
+    for (i = 0; i < 256; i++) {
+        int u = ~i & 0xFF;
+        int exp = (u >> 4) & 0x07;
+        int mag = (((u & 0x0F) << 3) + 0x84) << exp;
+        ringback_ulaw_table[i] = (int16_t)((u & 0x80) ? (0x84 - mag) : (mag - 0x84));
+
+        int a = i ^ 0x55;
+        exp = (a >> 4) & 0x07;
+        mag = ((a & 0x0F) << 4) + 8;
+        if (exp) {
+            mag = (mag + 0x100) << (exp - 1);
+        }
+        ringback_alaw_table[i] = (int16_t)((a & 0x80) ? mag : -mag);
+    }
+}
+
+static void g711_decode_scalar(const uint8_t *in, int16_t *out, int count, int law)
+{
+    const int16_t *table = law == RINGBACK_G711_ALAW ? ringback_alaw_table : ringback_ulaw_table;
+    int i;
+    for (i = 0; i < count; i++) {
+        out[i] = table[in[i]];
+    }
+}
+
+static int supported_always(void)
+{
+    return 1;
+}
+
+#ifdef RINGBACK_DSP_X86
+/*
+ * SIMD 递推 s0 = x + ((coef * s1) >> Q) - s2
+ *
+ * coef * s1 需要 64 位乘积：mul_epi32 只乘偶数 32 位通道，奇数通道右移 32 位后
+ * 再乘一次。(p >> Q) 的低 32 位即 p 的第 Q..Q+31 位，偶数通道逻辑右移 Q 位、
+ * 奇数通道左移 32-Q 位后按 32 位通道混合，结果与标量截断逐位一致。
+ */
+__attribute__((target("sse4.1")))
+static inline __m128i goertzel_step_sse41(__m128i x, __m128i coef, __m128i s1, __m128i s2)
+{
+    __m128i even = _mm_mul_epi32(coef, s1);
+    __m128i odd = _mm_mul_epi32(_mm_srli_epi64(coef, 32), _mm_srli_epi64(s1, 32));
+    __m128i prod = _mm_blend_epi16(_mm_srli_epi64(even, RINGBACK_COEF_Q),
+                                   _mm_slli_epi64(odd, 32 - RINGBACK_COEF_Q), 0xCC);
+    return _mm_sub_epi32(_mm_add_epi32(x, prod), s2);
+}
+
+__attribute__((target("sse4.1")))
+static uint64_t bank_process_sse41(ringback_bank_t *b, const int16_t *samples, int count)
+{
+    __m128i coef[RINGBACK_BANK_MAX_BINS / 4], s1[RINGBACK_BANK_MAX_BINS / 4], s2[RINGBACK_BANK_MAX_BINS / 4];
+    int nvec = (b->nbins + 3) / 4;
+    uint64_t sumsq = 0;
+    int i, v;
+
+    for (v = 0; v < nvec; v++) {
+        coef[v] = _mm_loadu_si128((const __m128i *)&b->coef[v * 4]);
+        s1[v] = _mm_loadu_si128((const __m128i *)&b->s1[v * 4]);
+        s2[v] = _mm_loadu_si128((const __m128i *)&b->s2[v * 4]);
+    }
+
+    for (i = 0; i < count; i++) {
+        int32_t x = samples[i];
+        __m128i vx = _mm_set1_epi32(x);
+        sumsq += (uint32_t)(x * x);
+        for (v = 0; v < nvec; v++) {
+            __m128i s0 = goertzel_step_sse41(vx, coef[v], s1[v], s2[v]);
+            s2[v] = s1[v];
+            s1[v] = s0;
+        }
+    }
+
+    for (v = 0; v < nvec; v++) {
+        _mm_storeu_si128((__m128i *)&b->s1[v * 4], s1[v]);
+        _mm_storeu_si128((__m128i *)&b->s2[v * 4], s2[v]);
+    }
+
+    b->count += count;
+    return sumsq;
+}
+
+__attribute__((target("avx2")))
+static inline __m256i goertzel_step_avx2(__m256i x, __m256i coef, __m256i s1, __m256i s2)
+{
+    __m256i even = _mm256_mul_epi32(coef, s1);
+    __m256i odd = _mm256_mul_epi32(_mm256_srli_epi64(coef, 32), _mm256_srli_epi64(s1, 32));
+    __m256i prod = _mm256_blend_epi32(_mm256_srli_epi64(even, RINGBACK_COEF_Q),
+                                      _mm256_slli_epi64(odd, 32 - RINGBACK_COEF_Q), 0xAA);
+    return _mm256_sub_epi32(_mm256_add_epi32(x, prod), s2);
+}
+
+__attribute__((target("avx2")))
+static uint64_t bank_process_avx2(ringback_bank_t *b, const int16_t *samples, int count)
+{
+    __m256i coef[RINGBACK_BANK_MAX_BINS / 8], s1[RINGBACK_BANK_MAX_BINS / 8], s2[RINGBACK_BANK_MAX_BINS / 8];
+    int nvec = (b->nbins + 7) / 8;
+    uint64_t sumsq = 0;
+    int i, v;
+
+    for (v = 0; v < nvec; v++) {
+        coef[v] = _mm256_loadu_si256((const __m256i *)&b->coef[v * 8]);
+        s1[v] = _mm256_loadu_si256((const __m256i *)&b->s1[v * 8]);
+        s2[v] = _mm256_loadu_si256((const __m256i *)&b->s2[v * 8]);
+    }
+
+    for (i = 0; i < count; i++) {
+        int32_t x = samples[i];
+        __m256i vx = _mm256_set1_epi32(x);
+        sumsq += (uint32_t)(x * x);
+        for (v = 0; v < nvec; v++) {
+            __m256i s0 = goertzel_step_avx2(vx, coef[v], s1[v], s2[v]);
+            s2[v] = s1[v];
+            s1[v] = s0;
+        }
+    }
+
+    for (v = 0; v < nvec; v++) {
+        _mm256_storeu_si256((__m256i *)&b->s1[v * 8], s1[v]);
+        _mm256_storeu_si256((__m256i *)&b->s2[v * 8], s2[v]);
+    }
+
+    b->count += count;
+    return sumsq;
+}
+
+/* 16 路通道 = 4 个 SSE 向量，每个频点 4 条独立递推链 */
+__attribute__((target("sse4.1")))
+static void batch_process_sse41(const int16_t *x, int n, const int32_t *coef, int nbins,
+                                int32_t *s1out, int32_t *s2out)
+{
+    int k, i, v;
+
+    for (k = 0; k < nbins; k++) {
+        __m128i c = _mm_set1_epi32(coef[k]);
+        __m128i s1[4], s2[4];
+        for (v = 0; v < 4; v++) {
+            s1[v] = s2[v] = _mm_setzero_si128();
+        }
+        for (i = 0; i < n; i++) {
+            const int16_t *xi = x + i * RINGBACK_BATCH_LANES;
+            __m128i lo = _mm_loadu_si128((const __m128i *)xi);
+            __m128i hi = _mm_loadu_si128((const __m128i *)(xi + 8));
+            __m128i vx[4];
+            vx[0] = _mm_cvtepi16_epi32(lo);
+            vx[1] = _mm_cvtepi16_epi32(_mm_srli_si128(lo, 8));
+            vx[2] = _mm_cvtepi16_epi32(hi);
+            vx[3] = _mm_cvtepi16_epi32(_mm_srli_si128(hi, 8));
+            for (v = 0; v < 4; v++) {
+                __m128i s0 = goertzel_step_sse41(vx[v], c, s1[v], s2[v]);
+                s2[v] = s1[v];
+                s1[v] = s0;
+            }
+        }
+        for (v = 0; v < 4; v++) {
+            _mm_storeu_si128((__m128i *)(s1out + k * RINGBACK_BATCH_LANES + v * 4), s1[v]);
+            _mm_storeu_si128((__m128i *)(s2out + k * RINGBACK_BATCH_LANES + v * 4), s2[v]);
+        }
+    }
+}
+
+/* 16 路通道 = 2 个 AVX2 向量，每次处理两个频点以获得 4 条独立递推链 */
+__attribute__((target("avx2")))
+static void batch_process_avx2(const int16_t *x, int n, const int32_t *coef, int nbins,
+                               int32_t *s1out, int32_t *s2out)
+{
+    int k, i;
+
+    for (k = 0; k < nbins; k += 2) {
+        int pair = (k + 1 < nbins);
+        __m256i k0 = _mm256_set1_epi32(coef[k]);
+        __m256i k1 = _mm256_set1_epi32(pair ? coef[k + 1] : 0);
+        __m256i a1 = _mm256_setzero_si256(), a2 = a1, b1 = a1, b2 = a1;
+        __m256i c1 = a1, c2 = a1, d1 = a1, d2 = a1;
+
+        for (i = 0; i < n; i++) {
+            const int16_t *xi = x + i * RINGBACK_BATCH_LANES;
+            __m256i xa = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *)xi));
+            __m256i xb = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *)(xi + 8)));
+            __m256i a0 = goertzel_step_avx2(xa, k0, a1, a2);
+            __m256i b0 = goertzel_step_avx2(xb, k0, b1, b2);
+            __m256i c0 = goertzel_step_avx2(xa, k1, c1, c2);
+            __m256i d0 = goertzel_step_avx2(xb, k1, d1, d2);
+            a2 = a1; a1 = a0;
+            b2 = b1; b1 = b0;
+            c2 = c1; c1 = c0;
+            d2 = d1; d1 = d0;
+        }
+
+        _mm256_storeu_si256((__m256i *)(s1out + k * RINGBACK_BATCH_LANES), a1);
+        _mm256_storeu_si256((__m256i *)(s2out + k * RINGBACK_BATCH_LANES), a2);
+        _mm256_storeu_si256((__m256i *)(s1out + k * RINGBACK_BATCH_LANES + 8), b1);
+        _mm256_storeu_si256((__m256i *)(s2out + k * RINGBACK_BATCH_LANES + 8), b2);
+        if (pair) {
+            _mm256_storeu_si256((__m256i *)(s1out + (k + 1) * RINGBACK_BATCH_LANES), c1);
+            _mm256_storeu_si256((__m256i *)(s2out + (k + 1) * RINGBACK_BATCH_LANES), c2);
+            _mm256_storeu_si256((__m256i *)(s1out + (k + 1) * RINGBACK_BATCH_LANES + 8), d1);
+            _mm256_storeu_si256((__m256i *)(s2out + (k + 1) * RINGBACK_BATCH_LANES + 8), d2);
+        }
+    }
+}
+
+__attribute__((target("avx512f")))
+static inline __m512i goertzel_step_avx512(__m512i x, __m512i coef, __m512i s1, __m512i s2)
+{
+    __m512i even = _mm512_mul_epi32(coef, s1);
+    __m512i odd = _mm512_mul_epi32(_mm512_srli_epi64(coef, 32), _mm512_srli_epi64(s1, 32));
+    __m512i prod = _mm512_mask_blend_epi32(0xAAAA, _mm512_srli_epi64(even, RINGBACK_COEF_Q),
+                                           _mm512_slli_epi64(odd, 32 - RINGBACK_COEF_Q));
+    return _mm512_sub_epi32(_mm512_add_epi32(x, prod), s2);
+}
+
+/* 全部 16 个频点放在一个向量中 */
+__attribute__((target("avx512f")))
+static uint64_t bank_process_avx512(ringback_bank_t *b, const int16_t *samples, int count)
+{
+    __m512i coef = _mm512_loadu_si512(b->coef);
+    __m512i s1 = _mm512_loadu_si512(b->s1);
+    __m512i s2 = _mm512_loadu_si512(b->s2);
+    uint64_t sumsq = 0;
+    int i;
+
+    for (i = 0; i < count; i++) {
+        int32_t x = samples[i];
+        __m512i s0 = goertzel_step_avx512(_mm512_set1_epi32(x), coef, s1, s2);
+        sumsq += (uint32_t)(x * x);
+        s2 = s1;
+        s1 = s0;
+    }
+
+    _mm512_storeu_si512(b->s1, s1);
+    _mm512_storeu_si512(b->s2, s2);
+
+    b->count += count;
+    return sumsq;
+}
+
+/* 16 路通道 = 1 个 AVX-512 向量，每次处理四个频点以获得 4 条独立递推链 */
+__attribute__((target("avx512f")))
+static void batch_process_avx512(const int16_t *x, int n, const int32_t *coef, int nbins,
+                                 int32_t *s1out, int32_t *s2out)
+{
+    int k, i, j;
+
+    for (k = 0; k < nbins; k += 4) {
+        int nb = nbins - k < 4 ? nbins - k : 4;
+        __m512i kc[4], s1[4], s2[4];
+
+        for (j = 0; j < 4; j++) {
+            kc[j] = _mm512_set1_epi32(j < nb ? coef[k + j] : 0);
+            s1[j] = s2[j] = _mm512_setzero_si512();
+        }
+
+        for (i = 0; i < n; i++) {
+            __m512i vx = _mm512_cvtepi16_epi32(_mm256_loadu_si256((const __m256i *)(x + i * RINGBACK_BATCH_LANES)));
+            __m512i a0 = goertzel_step_avx512(vx, kc[0], s1[0], s2[0]);
+            __m512i b0 = goertzel_step_avx512(vx, kc[1], s1[1], s2[1]);
+            __m512i c0 = goertzel_step_avx512(vx, kc[2], s1[2], s2[2]);
+            __m512i d0 = goertzel_step_avx512(vx, kc[3], s1[3], s2[3]);
+            s2[0] = s1[0]; s1[0] = a0;
+            s2[1] = s1[1]; s1[1] = b0;
+            s2[2] = s1[2]; s1[2] = c0;
+            s2[3] = s1[3]; s1[3] = d0;
+        }
+
+        for (j = 0; j < nb; j++) {
+            _mm512_storeu_si512(s1out + (k + j) * RINGBACK_BATCH_LANES, s1[j]);
+            _mm512_storeu_si512(s2out + (k + j) * RINGBACK_BATCH_LANES, s2[j]);
+        }
+    }
+}
+
+/*
+ * G.711 SIMD 解码，每次 16 字节
+ *
+ * µ-law: |x| = ((mant << 3) + 0x84) * 2^exp - 0x84
+ * A-law: |x| = ((mant << 4) + 8 + (exp ? 0x100 : 0)) * 2^max(exp-1, 0)
+ * 段号 exp 只有 8 种取值，2^exp 和 A-law 偏置用 pshufb 查 16 字节小表，
+ * 乘法用 16 位 mullo，最大值 32256 不溢出。16 位通道的高字节 (索引 0) 也会被
+ * pshufb 查表，结果需屏蔽为低字节。
+ */
+__attribute__((target("sse4.1")))
+static inline __m128i g711_decode8_sse41(__m128i bytes16, int law)
+{
+    const __m128i mask_lo4 = _mm_set1_epi16(0x0F);
+    const __m128i mask_exp = _mm_set1_epi16(0x07);
+    __m128i v, sign, exp, mant, mult, mag;
+
+    if (law == RINGBACK_G711_ALAW) {
+        const __m128i mul_tab = _mm_setr_epi8(1, 1, 2, 4, 8, 16, 32, 64, 0, 0, 0, 0, 0, 0, 0, 0);
+        const __m128i seg_tab = _mm_setr_epi8(0, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0);
+        v = _mm_xor_si128(bytes16, _mm_set1_epi16(0x55));
+        exp = _mm_and_si128(_mm_srli_epi16(v, 4), mask_exp);
+        mant = _mm_and_si128(v, mask_lo4);
+        mult = _mm_and_si128(_mm_shuffle_epi8(mul_tab, exp), _mm_set1_epi16(0xFF));
+        mag = _mm_add_epi16(_mm_slli_epi16(mant, 4), _mm_set1_epi16(8));
+        mag = _mm_add_epi16(mag, _mm_slli_epi16(_mm_shuffle_epi8(seg_tab, exp), 8));
+        mag = _mm_mullo_epi16(mag, mult);
+        /* A-law 符号位为 1 表示正 */
+        sign = _mm_cmpeq_epi16(_mm_and_si128(v, _mm_set1_epi16(0x80)), _mm_setzero_si128());
+    } else {
+        const __m128i mul_tab = _mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, (char)128, 0, 0, 0, 0, 0, 0, 0, 0);
+        v = _mm_andnot_si128(bytes16, _mm_set1_epi16(0xFF));
+        exp = _mm_and_si128(_mm_srli_epi16(v, 4), mask_exp);
+        mant = _mm_and_si128(v, mask_lo4);
+        mult = _mm_and_si128(_mm_shuffle_epi8(mul_tab, exp), _mm_set1_epi16(0xFF));
+        mag = _mm_add_epi16(_mm_slli_epi16(mant, 3), _mm_set1_epi16(0x84));
+        mag = _mm_sub_epi16(_mm_mullo_epi16(mag, mult), _mm_set1_epi16(0x84));
+        /* µ-law 取反后符号位为 1 表示负 */
+        sign = _mm_cmpgt_epi16(_mm_and_si128(v, _mm_set1_epi16(0x80)), _mm_setzero_si128());
+    }
+
+    /* sign 为全 1 时取负：(mag ^ sign) - sign */
+    return _mm_sub_epi16(_mm_xor_si128(mag, sign), sign);
+}
+
+__attribute__((target("sse4.1")))
+static void g711_decode_sse41(const uint8_t *in, int16_t *out, int count, int law)
+{
+    int i = 0;
+
+    for (; i + 16 <= count; i += 16) {
+        __m128i raw = _mm_loadu_si128((const __m128i *)(in + i));
+        __m128i lo = _mm_cvtepu8_epi16(raw);
+        __m128i hi = _mm_cvtepu8_epi16(_mm_srli_si128(raw, 8));
+        _mm_storeu_si128((__m128i *)(out + i), g711_decode8_sse41(lo, law));
+        _mm_storeu_si128((__m128i *)(out + i + 8), g711_decode8_sse41(hi, law));
+    }
+
+    g711_decode_scalar(in + i, out + i, count - i, law);
+}
+
+static int supported_sse41(void)
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse4.1");
+}
+
+static int supported_avx2(void)
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+}
+
+static int supported_avx512(void)
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx512f");
+}
+#endif /* RINGBACK_DSP_X86 */
+
+/* 按优先级从低到高排列 */
+static const ringback_kernel_t kernels[] = {
+    { "scalar", bank_process_scalar, batch_process_scalar, g711_decode_scalar, supported_always },
+#ifdef RINGBACK_DSP_X86
+    /* G.711 解码占比很小，AVX2/AVX-512 档沿用 128 位 shuffle 版本 */
+    { "sse4.1", bank_process_sse41, batch_process_sse41, g711_decode_sse41, supported_sse41 },
+    { "avx2", bank_process_avx2, batch_process_avx2, g711_decode_sse41, supported_avx2 },
+    { "avx512", bank_process_avx512, batch_process_avx512, g711_decode_sse41, supported_avx512 },
+#endif
+};
+
+#define KERNEL_COUNT ((int)(sizeof(kernels) / sizeof(kernels[0])))
+
+static const ringback_kernel_t *current_kernel = &kernels[0];
+
+/* 自校准测得的每帧耗时，0 表示未测量或不支持 */
+static double kernel_ns[KERNEL_COUNT];
+
+void ringback_dsp_init(void)
+{
+    int i;
+
+    g711_tables_init();
+    for (i = KERNEL_COUNT - 1; i > 0; i--) {
+        if (kernels[i].supported()) {
+            break;
+        }
+    }
+    current_kernel = &kernels[i];
+}
+
+int ringback_kernel_count(void)
+{
+    return KERNEL_COUNT;
+}
+
+const ringback_kernel_t *ringback_kernel_get(int index)
+{
+    return (index >= 0 && index < KERNEL_COUNT) ? &kernels[index] : NULL;
+}
+
+const ringback_kernel_t *ringback_kernel_current(void)
+{
+    return current_kernel;
+}
+
+int ringback_kernel_select(const char *name)
+{
+    int i;
+    for (i = 0; i < KERNEL_COUNT; i++) {
+        if (!strcmp(kernels[i].name, name) && kernels[i].supported()) {
+            current_kernel = &kernels[i];
+            return 0;
+        }
+    }
+    return -1;
+}
+
+/* 单调时钟纳秒，仅用于自校准 */
+static double calib_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+double ringback_kernel_measure(const ringback_kernel_t *kernel, int nbins, int frames)
+{
+    int16_t frame[RINGBACK_CALIB_FRAME];
+    double freqs[RINGBACK_BANK_MAX_BINS];
+    ringback_bank_t bank;
+    volatile uint64_t sink = 0;
+    double start, best = 0;
+    int i, round;
+
+    if (!kernel->supported()) {
+        return 0;
+    }
+    if (nbins < 1) nbins = 1;
+    if (nbins > RINGBACK_BANK_MAX_BINS) nbins = RINGBACK_BANK_MAX_BINS;
+
+    for (i = 0; i < nbins; i++) {
+        freqs[i] = 350.0 + 100.0 * i;
+    }
+    for (i = 0; i < RINGBACK_CALIB_FRAME; i++) {
+        frame[i] = (int16_t)(6000 * sin(2.0 * M_PI * 450.0 * i / 8000) + ((i * 7919) % 401) - 200);
+    }
+    ringback_bank_init(&bank, freqs, nbins, 8000);
+
+    /* 取三轮中最快的一轮，减少调度抖动影响 */
+    for (round = 0; round < 3; round++) {
+        start = calib_now_ns();
+        for (i = 0; i < frames; i++) {
+            sink += kernel->bank(&bank, frame, RINGBACK_CALIB_FRAME);
+            ringback_bank_reset(&bank);
+        }
+        double ns = (calib_now_ns() - start) / frames;
+        if (round == 0 || ns < best) {
+            best = ns;
+        }
+    }
+    (void)sink;
+
+    return best;
+}
+
+static int calib_cmp(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return x < y ? -1 : x > y;
+}
+
+const ringback_kernel_t *ringback_dsp_calibrate(int nbins)
+{
+    double ns[KERNEL_COUNT][RINGBACK_CALIB_ROUNDS];
+    const ringback_kernel_t *best = NULL;
+    int i, round, widest = 0;
+
+    /* 各内核交替测量，主机一时繁忙只会拖慢各内核的同一轮 */
+    for (round = 0; round < RINGBACK_CALIB_ROUNDS; round++) {
+        for (i = 0; i < KERNEL_COUNT; i++) {
+            ns[i][round] = ringback_kernel_measure(&kernels[i], nbins, RINGBACK_CALIB_FRAMES);
+        }
+    }
+    for (i = 0; i < KERNEL_COUNT; i++) {
+        qsort(ns[i], RINGBACK_CALIB_ROUNDS, sizeof(ns[i][0]), calib_cmp);
+        kernel_ns[i] = ns[i][RINGBACK_CALIB_ROUNDS / 2];
+        if (kernel_ns[i] > 0) {
+            widest = i;
+        }
+    }
+
+    /* 保留 CPU 支持的最宽内核，其他内核须快出 RINGBACK_CALIB_MARGIN 才换用 */
+    best = &kernels[widest];
+    for (i = 0; i < KERNEL_COUNT; i++) {
+        if (kernel_ns[i] > 0 && kernel_ns[i] < kernel_ns[widest] * (1.0 - RINGBACK_CALIB_MARGIN) &&
+            kernel_ns[i] < kernel_ns[best - kernels]) {
+            best = &kernels[i];
+        }
+    }
+
+    current_kernel = best;
+    return best;
+}
+
+double ringback_kernel_ns(const ringback_kernel_t *kernel)
+{
+    int i = (int)(kernel - kernels);
+    return (i >= 0 && i < KERNEL_COUNT) ? kernel_ns[i] : 0;
+}
+
+uint64_t ringback_bank_process(ringback_bank_t *b, const int16_t *samples, int count)
+{
+    return current_kernel->bank(b, samples, count);
+}
+
+void ringback_stream_init(ringback_stream_t *st, const ringback_bank_t *bank, int block_len)
+{
+    memset(st, 0, sizeof(*st));
+    st->bank = *bank;
+    ringback_bank_reset(&st->bank);
+    st->block_len = block_len;
+}
+
+/* 块内位置 pos 起的 n 个样本累加到各段平方和，段 k 覆盖 [ceil(k*L/S), ceil((k+1)*L/S)) */
+static void stream_envelope(ringback_stream_t *st, const int16_t *x, int pos, int n)
+{
+    while (n > 0) {
+        int slot = pos * RINGBACK_ENV_SLOTS / st->block_len;
+        int m = ((slot + 1) * st->block_len + RINGBACK_ENV_SLOTS - 1) / RINGBACK_ENV_SLOTS - pos;
+        uint64_t acc = 0;
+        int i;
+
+        if (m > n) {
+            m = n;
+        }
+        for (i = 0; i < m; i++) {
+            acc += (uint32_t)(x[i] * x[i]);
+        }
+        st->env[slot] += acc;
+        pos += m;
+        x += m;
+        n -= m;
+    }
+}
+
+int ringback_stream_feed(ringback_stream_t *st, const int16_t *samples, int count,
+                         ringback_block_t *out, int max_out)
+{
+    int nout = 0, k;
+
+    while (count > 0) {
+        int n = st->block_len - st->bank.count;
+        if (n > count) {
+            n = count;
+        }
+
+        if (st->block_len >= RINGBACK_ENV_SLOTS) {
+            stream_envelope(st, samples, st->bank.count, n);
+        }
+        st->sumsq += ringback_bank_process(&st->bank, samples, n);
+        st->samples += n;
+        samples += n;
+        count -= n;
+
+        if (st->bank.count >= st->block_len) {
+            if (nout < max_out) {
+                ringback_block_t *blk = &out[nout++];
+                blk->sumsq = st->sumsq;
+                blk->count = st->bank.count;
+                blk->end_sample = st->samples;
+                ringback_bank_powers(&st->bank, blk->power);
+                blk->env_n = st->block_len >= RINGBACK_ENV_SLOTS ? RINGBACK_ENV_SLOTS : 0;
+                for (k = 0; k < blk->env_n; k++) {
+                    int lo = (k * st->block_len + RINGBACK_ENV_SLOTS - 1) / RINGBACK_ENV_SLOTS;
+                    int hi = ((k + 1) * st->block_len + RINGBACK_ENV_SLOTS - 1) / RINGBACK_ENV_SLOTS;
+                    blk->env[k] = (float)st->env[k] / (hi - lo);
+                }
+            } else {
+                st->dropped++;
+            }
+            ringback_bank_reset(&st->bank);
+            st->sumsq = 0;
+            memset(st->env, 0, sizeof(st->env));
+        }
+    }
+
+    return nout;
+}
+
+void ringback_stream_skip(ringback_stream_t *st, uint64_t n)
+{
+    ringback_bank_reset(&st->bank);
+    st->sumsq = 0;
+    memset(st->env, 0, sizeof(st->env));
+    st->samples += n;
+}
+
+/* 抗混叠截止频率：保留 3.5kHz 以下，足以覆盖所有信号音频点 */
+#define DECIM_CUTOFF_HZ 3500.0
+
+int ringback_decim_init(ringback_decim_t *d, int in_rate, int out_rate)
+{
+    double h[RINGBACK_DECIM_MAX_TAPS], sum = 0;
+    int k;
+
+    memset(d, 0, sizeof(*d));
+    if (out_rate <= 0 || in_rate % out_rate || in_rate / out_rate < 1 ||
+        in_rate / out_rate > RINGBACK_DECIM_MAX_FACTOR) {
+        return -1;
+    }
+
+    d->factor = in_rate / out_rate;
+    d->ntaps = RINGBACK_DECIM_TAPS_PER_PHASE * d->factor;
+    d->phase = d->factor;
+
+    /* Hamming 窗 sinc 低通，直流增益归一化为 1 */
+    for (k = 0; k < d->ntaps; k++) {
+        double t = k - (d->ntaps - 1) / 2.0;
+        double wc = 2.0 * DECIM_CUTOFF_HZ / in_rate;
+        double sinc = t == 0 ? wc : sin(M_PI * wc * t) / (M_PI * t);
+        h[k] = sinc * (0.54 - 0.46 * cos(2.0 * M_PI * k / (d->ntaps - 1)));
+        sum += h[k];
+    }
+    for (k = 0; k < d->ntaps; k++) {
+        d->taps[k] = (int16_t)lrint(h[k] / sum * 32767.0);
+    }
+
+    return 0;
+}
+
+int ringback_decim_process(ringback_decim_t *d, const int16_t *in, int count, int16_t *out)
+{
+    int nout = 0;
+    int i, k;
+
+    for (i = 0; i < count; i++) {
+        d->delay[d->pos] = d->delay[d->pos + d->ntaps] = in[i];
+        if (++d->pos == d->ntaps) {
+            d->pos = 0;
+        }
+
+        /* 只在被保留的相位上计算点积 */
+        if (--d->phase == 0) {
+            const int16_t *x = d->delay + d->pos;   /* 最旧样本在前 */
+            int32_t acc = 0;
+            for (k = 0; k < d->ntaps; k++) {
+                acc += (int32_t)x[k] * d->taps[d->ntaps - 1 - k];
+            }
+            acc = (acc + (1 << 14)) >> 15;
+            out[nout++] = (int16_t)(acc > 32767 ? 32767 : acc < -32768 ? -32768 : acc);
+            d->phase = d->factor;
+        }
+    }
+
+    return nout;
+}
+
+int ringback_g711_law(const char *iananame)
+{
+    if (!iananame) {
+        return RINGBACK_G711_NONE;
+    }
+    if (!strcasecmp(iananame, "PCMU")) {
+        return RINGBACK_G711_ULAW;
+    }
+    if (!strcasecmp(iananame, "PCMA")) {
+        return RINGBACK_G711_ALAW;
+    }
+    return RINGBACK_G711_NONE;
+}
+
+void ringback_g711_decode(const uint8_t *in, int16_t *out, int count, int law)
+{
+    current_kernel->g711(in, out, count, law);
+}
+
+#define G711_CHUNK 160
+
+int ringback_stream_feed_g711(ringback_stream_t *st, int law, const uint8_t *payload, int count,
+                              ringback_block_t *out, int max_out)
+{
+    int16_t linear[G711_CHUNK];
+    int nout = 0;
+
+    /* 分段解码到栈上，避免整帧缓冲 */
+    while (count > 0) {
+        int n = count < G711_CHUNK ? count : G711_CHUNK;
+        current_kernel->g711(payload, linear, n, law);
+        nout += ringback_stream_feed(st, linear, n, out + nout, max_out - nout);
+        payload += n;
+        count -= n;
+    }
+
+    return nout;
+}
+
+struct ringback_batch {
+    int capacity;
+    int ngroups;
+    int nbins;
+    int32_t coef[RINGBACK_BANK_MAX_BINS];
+    int16_t *stage[2];                  /* [ngroups][MAX_SAMPLES][LANES] */
+    int *stage_count[2];                /* [capacity] */
+    int fill;
+    ringback_batch_result_t *results[2];
+    int pub;
+    uint32_t tick;
+    const void **owner;
+    uint32_t *last_push;                /* 最近一次写入数据的轮次 */
+    ringback_batch_result_t *pending;   /* [capacity][RINGBACK_BATCH_PENDING] 待取结果 */
+    uint8_t *npending;                  /* [capacity] */
+    int32_t s1[RINGBACK_BANK_MAX_BINS * RINGBACK_BATCH_LANES];
+    int32_t s2[RINGBACK_BANK_MAX_BINS * RINGBACK_BATCH_LANES];
+};
+
+#define GROUP_STRIDE (RINGBACK_BATCH_MAX_SAMPLES * RINGBACK_BATCH_LANES)
+
+ringback_batch_t *ringback_batch_create(int capacity, const double *freqs, int nbins, int rate)
+{
+    ringback_batch_t *b;
+    int i;
+
+    if (capacity <= 0 || nbins < 0 || nbins > RINGBACK_BANK_MAX_BINS) {
+        return NULL;
+    }
+
+    if (!(b = calloc(1, sizeof(*b)))) {
+        return NULL;
+    }
+
+    b->ngroups = (capacity + RINGBACK_BATCH_LANES - 1) / RINGBACK_BATCH_LANES;
+    b->capacity = b->ngroups * RINGBACK_BATCH_LANES;
+    b->nbins = nbins;
+    for (i = 0; i < nbins; i++) {
+        b->coef[i] = ringback_goertzel_coef(freqs[i], rate);
+    }
+
+    for (i = 0; i < 2; i++) {
+        b->stage[i] = calloc((size_t)b->ngroups * GROUP_STRIDE, sizeof(int16_t));
+        b->stage_count[i] = calloc(b->capacity, sizeof(int));
+        b->results[i] = calloc(b->capacity, sizeof(ringback_batch_result_t));
+        if (!b->stage[i] || !b->stage_count[i] || !b->results[i]) {
+            ringback_batch_destroy(b);
+            return NULL;
+        }
+    }
+    b->owner = calloc(b->capacity, sizeof(void *));
+    b->last_push = calloc(b->capacity, sizeof(uint32_t));
+    b->pending = calloc((size_t)b->capacity * RINGBACK_BATCH_PENDING, sizeof(ringback_batch_result_t));
+    b->npending = calloc(b->capacity, sizeof(uint8_t));
+    if (!b->owner || !b->last_push || !b->pending || !b->npending) {
+        ringback_batch_destroy(b);
+        return NULL;
+    }
+
+    return b;
+}
+
+void ringback_batch_destroy(ringback_batch_t *b)
+{
+    int i;
+
+    if (!b) {
+        return;
+    }
+
+    for (i = 0; i < 2; i++) {
+        free(b->stage[i]);
+        free(b->stage_count[i]);
+        free(b->results[i]);
+    }
+    free(b->owner);
+    free(b->last_push);
+    free(b->pending);
+    free(b->npending);
+    free(b);
+}
+
+int ringback_batch_acquire(ringback_batch_t *b, const void *owner)
+{
+    int slot;
+
+    for (slot = 0; slot < b->capacity; slot++) {
+        if (!b->owner[slot]) {
+            b->owner[slot] = owner;
+            b->last_push[slot] = b->tick;
+            b->npending[slot] = 0;
+            return slot;
+        }
+    }
+    return -1;
+}
+
+void ringback_batch_release(ringback_batch_t *b, int slot)
+{
+    if (slot >= 0 && slot < b->capacity) {
+        b->owner[slot] = NULL;
+        b->npending[slot] = 0;
+    }
+}
+
+const void *ringback_batch_owner(const ringback_batch_t *b, int slot)
+{
+    return (slot >= 0 && slot < b->capacity) ? b->owner[slot] : NULL;
+}
+
+int ringback_batch_reap(ringback_batch_t *b, uint32_t idle_ticks)
+{
+    int slot, reaped = 0;
+
+    for (slot = 0; slot < b->capacity; slot++) {
+        if (b->owner[slot] && b->tick - b->last_push[slot] > idle_ticks) {
+            b->owner[slot] = NULL;
+            b->npending[slot] = 0;
+            reaped++;
+        }
+    }
+    return reaped;
+}
+
+int ringback_batch_push(ringback_batch_t *b, int slot, const int16_t *samples, int count)
+{
+    int16_t *dst;
+    int *have = &b->stage_count[b->fill][slot];
+    int room = RINGBACK_BATCH_MAX_SAMPLES - *have;
+    int n = count < room ? count : room;
+    int i;
+
+    /* 转置写入：样本 i 位于 [i][lane] */
+    dst = b->stage[b->fill] + (slot / RINGBACK_BATCH_LANES) * GROUP_STRIDE
+          + *have * RINGBACK_BATCH_LANES + slot % RINGBACK_BATCH_LANES;
+    for (i = 0; i < n; i++) {
+        dst[i * RINGBACK_BATCH_LANES] = samples[i];
+    }
+    *have += n;
+    b->last_push[slot] = b->tick;
+
+    return n == count ? 0 : -1;
+}
+
+void ringback_batch_swap(ringback_batch_t *b)
+{
+    b->fill ^= 1;
+}
+
+void ringback_batch_run(ringback_batch_t *b)
+{
+    int back = b->fill ^ 1;
+    ringback_batch_result_t *out = b->results[b->pub ^ 1];
+    uint32_t tick = b->tick + 1;
+    int g, l, i, k;
+
+    for (g = 0; g < b->ngroups; g++) {
+        int16_t *x = b->stage[back] + g * GROUP_STRIDE;
+        int *count = b->stage_count[back] + g * RINGBACK_BATCH_LANES;
+        ringback_batch_result_t *r = out + g * RINGBACK_BATCH_LANES;
+        uint64_t sumsq[RINGBACK_BATCH_LANES] = { 0 };
+        int n = 0;
+
+        for (l = 0; l < RINGBACK_BATCH_LANES; l++) {
+            r[l].tick = tick;
+            r[l].count = count[l];
+            if (count[l] > n) {
+                n = count[l];
+            }
+        }
+        if (n == 0) {
+            continue;
+        }
+
+        current_kernel->batch(x, n, b->coef, b->nbins, b->s1, b->s2);
+
+        for (i = 0; i < n; i++) {
+            for (l = 0; l < RINGBACK_BATCH_LANES; l++) {
+                int32_t v = x[i * RINGBACK_BATCH_LANES + l];
+                sumsq[l] += (uint32_t)(v * v);
+            }
+        }
+
+        for (l = 0; l < RINGBACK_BATCH_LANES; l++) {
+            r[l].sumsq = sumsq[l];
+            for (k = 0; k < b->nbins; k++) {
+                int idx = k * RINGBACK_BATCH_LANES + l;
+                r[l].power[k] = bin_power(b->coef[k], b->s1[idx], b->s2[idx]);
+            }
+        }
+
+        /* 清空已处理的暂存区，供下一次 swap 后填充 */
+        memset(x, 0, (size_t)n * RINGBACK_BATCH_LANES * sizeof(int16_t));
+        memset(count, 0, RINGBACK_BATCH_LANES * sizeof(int));
+    }
+}
+
+/* 发布后把本轮有数据的结果追加到各槽位的待取队列 */
+void ringback_batch_publish(ringback_batch_t *b)
+{
+    const ringback_batch_result_t *r;
+    int slot;
+
+    b->pub ^= 1;
+    b->tick++;
+
+    r = b->results[b->pub];
+    for (slot = 0; slot < b->capacity; slot++) {
+        ringback_batch_result_t *q;
+        if (!r[slot].count || !b->owner[slot]) {
+            continue;
+        }
+        q = b->pending + (size_t)slot * RINGBACK_BATCH_PENDING;
+        if (b->npending[slot] == RINGBACK_BATCH_PENDING) {
+            memmove(q, q + 1, (RINGBACK_BATCH_PENDING - 1) * sizeof(*q));
+            b->npending[slot]--;
+        }
+        q[b->npending[slot]++] = r[slot];
+    }
+}
+
+const ringback_batch_result_t *ringback_batch_result(const ringback_batch_t *b, int slot)
+{
+    return &b->results[b->pub][slot];
+}
+
+int ringback_batch_take(ringback_batch_t *b, int slot, ringback_batch_result_t *out, int max)
+{
+    ringback_batch_result_t *q;
+    int n;
+
+    if (slot < 0 || slot >= b->capacity || max <= 0) {
+        return 0;
+    }
+    q = b->pending + (size_t)slot * RINGBACK_BATCH_PENDING;
+    n = b->npending[slot] < max ? b->npending[slot] : max;
+    memcpy(out, q, n * sizeof(*out));
+    b->npending[slot] -= (uint8_t)n;
+    memmove(q, q + n, b->npending[slot] * sizeof(*q));
+    return n;
+}
+
+void ringback_ref_goertzel_init(ringback_goertzel_ref_t *g, double freq, int rate)
+{
+    memset(g, 0, sizeof(*g));
+    g->coef = 2.0 * cos(2.0 * M_PI * freq / rate);
+}
+
+void ringback_ref_goertzel_process(ringback_goertzel_ref_t *g, const int16_t *samples, int count)
+{
+    int i;
+    for (i = 0; i < count; i++) {
+        double s0 = (double)samples[i] + g->coef * g->s1 - g->s2;
+        g->s2 = g->s1;
+        g->s1 = s0;
+    }
+    g->count += count;
+}
+
+double ringback_ref_goertzel_power(const ringback_goertzel_ref_t *g)
+{
+    return g->s1 * g->s1 + g->s2 * g->s2 - g->coef * g->s1 * g->s2;
+}
+
+double ringback_ref_frame_energy(const int16_t *samples, int count)
+{
+    double sum = 0;
+    int i;
+    for (i = 0; i < count; i++) {
+        sum += (double)samples[i] * samples[i];
+    }
+    return sqrt(sum / count);
+}
@@ -0,0 +1,291 @@
+/*
+ * ringback_dsp - 回铃音识别 DSP 内核
+ *
+ * 不依赖 FreeSWITCH，mod_ringback、单元测试和基准测试共用同一份实现。
+ *
+ * 定点约定：
+ * - 输入为 16bit 线性 PCM
+ * - Goertzel 系数 2cos(w) 用 Q14 表示，状态为 int32，乘积用 int64 计算
+ * - 能量以平方和 (sum of squares) 表示，阈值比较时两边同时平方，不做 sqrt
+ */
+#ifndef RINGBACK_DSP_H
+#define RINGBACK_DSP_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Goertzel 系数定点位数 */
+#define RINGBACK_COEF_Q 14
+
+/* 单频点定点 Goertzel 状态 */
+typedef struct ringback_goertzel {
+    int32_t coef;   /* 2cos(2*pi*f/fs), Q14 */
+    int32_t s1, s2;
+    int count;      /* 当前块已处理样本数 */
+} ringback_goertzel_t;
+
+/* 计算频点 freq 在采样率 rate 下的 Q14 系数 */
+int32_t ringback_goertzel_coef(double freq, int rate);
+
+void ringback_goertzel_init(ringback_goertzel_t *g, double freq, int rate);
+void ringback_goertzel_reset(ringback_goertzel_t *g);
+
+/*
+ * 单频点参考内核：一次遍历同时累加平方和与 Goertzel 递推，全整数运算。
+ * 返回 samples[0..count) 的平方和。模块不调用 (生产路径为 ringback_bank_process /
+ * ringback_stream_feed)，只供单元测试交叉校验滤波器组和基准测试对比
+ */
+uint64_t ringback_fused_process(ringback_goertzel_t *g, const int16_t *samples, int count);
+
+/* 仅计算平方和 (块外剩余样本) */
+uint64_t ringback_energy_sumsq(const int16_t *samples, int count);
+
+/* 当前块的 Goertzel 功率 |X(k)|^2，未归一化 */
+int64_t ringback_goertzel_power(const ringback_goertzel_t *g);
+
+/* RMS 能量是否超过阈值：sqrt(sumsq / count) > threshold 的无 sqrt 等价形式 */
+static inline int ringback_energy_above(uint64_t sumsq, int count, uint32_t threshold)
+{
+    return count > 0 && sumsq > (uint64_t)threshold * threshold * (uint64_t)count;
+}
+
+/*
+ * 多频点 Goertzel 滤波器组
+ *
+ * 同一批样本一次遍历计算最多 RINGBACK_BANK_MAX_BINS 个频点，SIMD 内核每条指令
+ * 处理 4 (SSE4.1)、8 (AVX2) 或 16 (AVX-512) 个频点。所有实现与标量版本逐位一致。
+ */
+#define RINGBACK_BANK_MAX_BINS 16
+
+typedef struct ringback_bank {
+    int32_t coef[RINGBACK_BANK_MAX_BINS];  /* Q14 */
+    int32_t s1[RINGBACK_BANK_MAX_BINS];
+    int32_t s2[RINGBACK_BANK_MAX_BINS];
+    double freq[RINGBACK_BANK_MAX_BINS];
+    int nbins;
+    int count;      /* 当前块已处理样本数 */
+} ringback_bank_t;
+
+/* 滤波器组内核：处理 count 个样本并返回其平方和 */
+typedef uint64_t (*ringback_bank_fn)(ringback_bank_t *b, const int16_t *samples, int count);
+
+/*
+ * 跨通道批处理内核：x 为转置后的 [n][RINGBACK_BATCH_LANES] 样本，一个 SIMD 通道
+ * 对应一路呼叫。s1/s2 输出为 [nbins][RINGBACK_BATCH_LANES] 的块末状态。
+ */
+typedef void (*ringback_batch_fn)(const int16_t *x, int n, const int32_t *coef, int nbins,
+                                  int32_t *s1, int32_t *s2);
+
+/* G.711 解码内核：count 字节 µ-law/A-law 载荷转为线性 PCM */
+typedef void (*ringback_g711_fn)(const uint8_t *in, int16_t *out, int count, int law);
+
+typedef struct ringback_kernel {
+    const char *name;
+    ringback_bank_fn bank;
+    ringback_batch_fn batch;
+    ringback_g711_fn g711;
+    int (*supported)(void);
+} ringback_kernel_t;
+
+/*
+ * 内核选择
+ *
+ * 所有 SIMD 内核都用函数级 target 属性编译，同一个二进制可在不同代 CPU 上运行。
+ * ringback_dsp_init 按 CPUID 选择支持的最高指令集；ringback_dsp_calibrate 再对
+ * 每个可用内核做短时自校准 (各内核交替测 RINGBACK_CALIB_ROUNDS 轮取中位数)，
+ * 默认保留最宽的内核，只有其他内核快出 RINGBACK_CALIB_MARGIN 以上时才换用
+ * (例如 AVX-512 降频时可能不如 AVX2)，加载时主机繁忙的单次抖动不会换掉它。
+ */
+#define RINGBACK_CALIB_FRAME  160   /* 校准帧长，20ms @ 8kHz */
+#define RINGBACK_CALIB_FRAMES 64    /* 每轮校准帧数 */
+#define RINGBACK_CALIB_ROUNDS 5     /* 每个内核的测量轮数，取中位数 */
+#define RINGBACK_CALIB_MARGIN 0.10  /* 换掉最宽内核所需的领先幅度 */
+
+void ringback_dsp_init(void);
+const ringback_kernel_t *ringback_dsp_calibrate(int nbins);
+/* 单个内核处理 nbins 频点的每帧耗时 (ns)，不支持返回 0 */
+double ringback_kernel_measure(const ringback_kernel_t *kernel, int nbins, int frames);
+/* 最近一次 ringback_dsp_calibrate 测得的中位数，未校准返回 0 */
+double ringback_kernel_ns(const ringback_kernel_t *kernel);
+
+int ringback_kernel_count(void);
+const ringback_kernel_t *ringback_kernel_get(int index);
+const ringback_kernel_t *ringback_kernel_current(void);
+/* 强制使用指定内核 (测试/基准用)，CPU 不支持时返回 -1 */
+int ringback_kernel_select(const char *name);
+
+/* 初始化滤波器组，nbins 超过上限返回 -1 */
+int ringback_bank_init(ringback_bank_t *b, const double *freqs, int nbins, int rate);
+void ringback_bank_reset(ringback_bank_t *b);
+/* 频点下标，不存在返回 -1 */
+int ringback_bank_find(const ringback_bank_t *b, double freq);
+
+/* 使用当前内核处理样本，返回平方和 (能量与滤波器组同一遍完成) */
+uint64_t ringback_bank_process(ringback_bank_t *b, const int16_t *samples, int count);
+
+/* 当前块各频点功率，out 至少 nbins 个元素 */
+void ringback_bank_powers(const ringback_bank_t *b, int64_t *out);
+
+/*
+ * 流式分块
+ *
+ * 帧长与块长无需对齐：不足一块的样本留在滤波器组状态中，与下一帧续接。
+ * 每凑满 block_len 个样本输出一个块，帧内所有样本都参与分析。
+ */
+#define RINGBACK_STREAM_MAX_BLOCKS 8    /* 单次 feed 最多输出的块数 */
+
+/* 子块能量包络：块等分为若干段 (20ms 块即 1ms 一段)，用于在块内定位响停边沿 */
+#define RINGBACK_ENV_SLOTS 20
+
+typedef struct ringback_block {
+    uint64_t sumsq;
+    int count;              /* 块内样本数 */
+    uint64_t end_sample;    /* 块结束位置 (自开始以来的累计样本数) */
+    int64_t power[RINGBACK_BANK_MAX_BINS];
+    int env_n;              /* env 有效段数，0 表示无包络 (批处理结果、CNG 块) */
+    float env[RINGBACK_ENV_SLOTS];  /* 各段均方值 */
+} ringback_block_t;
+
+typedef struct ringback_stream {
+    ringback_bank_t bank;
+    int block_len;
+    uint64_t sumsq;         /* 当前未完成块的平方和 */
+    uint64_t env[RINGBACK_ENV_SLOTS];   /* 当前未完成块的各段平方和 */
+    uint64_t samples;       /* 累计样本数 */
+    uint32_t dropped;       /* 因超出 max_out 未输出的块数 */
+} ringback_stream_t;
+
+void ringback_stream_init(ringback_stream_t *st, const ringback_bank_t *bank, int block_len);
+
+/* 喂入任意长度样本，返回本次完成的块数 (结果写入 out，最多 max_out 个) */
+int ringback_stream_feed(ringback_stream_t *st, const int16_t *samples, int count,
+                         ringback_block_t *out, int max_out);
+
+/*
+ * 跳过 n 个样本 (丢包等造成的空缺)：丢弃未完成的块，样本时钟前移，
+ * 使后续块的 end_sample 仍与真实时间对齐
+ */
+void ringback_stream_skip(ringback_stream_t *st, uint64_t n);
+
+/*
+ * 多相抽取
+ *
+ * 宽带输入 (G.722 16kHz、Opus 48kHz 等) 先抽取到 8kHz 分析率。整数倍率 M 的
+ * 抗混叠 FIR 只在每 M 个输入样本计算一次输出 (多相形式)，系数 Q15。
+ * 非整数倍率 (44.1kHz 等) 返回 -1，调用方改用该采样率下的滤波器组系数。
+ */
+#define RINGBACK_DECIM_TAPS_PER_PHASE 12
+#define RINGBACK_DECIM_MAX_FACTOR     8
+#define RINGBACK_DECIM_MAX_TAPS       (RINGBACK_DECIM_TAPS_PER_PHASE * RINGBACK_DECIM_MAX_FACTOR)
+
+typedef struct ringback_decim {
+    int factor;
+    int ntaps;
+    int phase;      /* 距下一个输出还差的输入样本数 */
+    int pos;
+    int16_t taps[RINGBACK_DECIM_MAX_TAPS];
+    int16_t delay[2 * RINGBACK_DECIM_MAX_TAPS];    /* 双倍长度环形缓冲，点积区间连续 */
+} ringback_decim_t;
+
+/* in_rate 须为 out_rate 的整数倍 (1..RINGBACK_DECIM_MAX_FACTOR)，否则返回 -1 */
+int ringback_decim_init(ringback_decim_t *d, int in_rate, int out_rate);
+/* 返回输出样本数，out 至少 count / factor + 1 个元素 */
+int ringback_decim_process(ringback_decim_t *d, const int16_t *in, int count, int16_t *out);
+
+/*
+ * G.711 原生分析
+ *
+ * 直接分析 PCMU/PCMA 载荷，不经过 FreeSWITCH 的解码。线性值来自 256 项查找表
+ * (与 ITU-T G.711 解码一致)，SIMD 内核用字节 shuffle 查每段的倍率和偏置，
+ * 结果与查表逐位一致。解码后的样本直接进入融合的能量/滤波器组内核。
+ */
+#define RINGBACK_G711_NONE 0
+#define RINGBACK_G711_ULAW 1
+#define RINGBACK_G711_ALAW 2
+
+extern int16_t ringback_ulaw_table[256];
+extern int16_t ringback_alaw_table[256];
+
+/* 按 iananame ("PCMU"/"PCMA") 返回编码类型，其他返回 RINGBACK_G711_NONE */
+int ringback_g711_law(const char *iananame);
+/* 使用当前内核解码 */
+void ringback_g711_decode(const uint8_t *in, int16_t *out, int count, int law);
+
+/* 喂入 G.711 载荷，语义同 ringback_stream_feed */
+int ringback_stream_feed_g711(ringback_stream_t *st, int law, const uint8_t *payload, int count,
+                              ringback_block_t *out, int max_out);
+
+/*
+ * 跨通道批处理引擎 (结构数组布局)
+ *
+ * 各通道把帧写入各自槽位 (按 RINGBACK_BATCH_LANES 路一组转置存放)，由一个线程
+ * 周期性地对所有槽位统一执行滤波器组与能量计算。每轮每个槽位得到一个块的结果，
+ * 块长为该轮写入的样本数 (同组较短的通道补零，不影响 Goertzel 幅度)。
+ *
+ * 暂存区和结果区均为双缓冲：push/swap/publish/result/take 由调用方加锁串行，
+ * run 只访问切出的暂存区和未发布的结果区，可在锁外执行。
+ *
+ * 帧长大于计算周期 (30/60ms 打包) 或抖动时，两次 push 之间会经过多轮，其中有的轮次
+ * 该槽位没有数据。publish 把有数据的结果追加到槽位的待取队列，属主用 take 取走，
+ * 不会被之后的空轮覆盖。
+ */
+#define RINGBACK_BATCH_LANES       16
+#define RINGBACK_BATCH_MAX_SAMPLES 480   /* 每轮每槽位最多样本数 (60ms @ 8kHz) */
+#define RINGBACK_BATCH_PENDING     4     /* 每槽位待取结果数，满时丢弃最老的 */
+
+typedef struct ringback_batch ringback_batch_t;
+
+typedef struct ringback_batch_result {
+    uint32_t tick;      /* 产生该结果的轮次 */
+    int count;          /* 本轮样本数，0 表示无数据 */
+    uint64_t sumsq;
+    int64_t power[RINGBACK_BANK_MAX_BINS];
+} ringback_batch_result_t;
+
+/* capacity 向上取整为 RINGBACK_BATCH_LANES 的倍数，失败返回 NULL */
+ringback_batch_t *ringback_batch_create(int capacity, const double *freqs, int nbins, int rate);
+void ringback_batch_destroy(ringback_batch_t *b);
+
+/* 分配槽位并记录属主，满时返回 -1 */
+int ringback_batch_acquire(ringback_batch_t *b, const void *owner);
+void ringback_batch_release(ringback_batch_t *b, int slot);
+const void *ringback_batch_owner(const ringback_batch_t *b, int slot);
+/* 回收连续 idle_ticks 轮无数据的槽位 (属主已消失)，返回回收数量 */
+int ringback_batch_reap(ringback_batch_t *b, uint32_t idle_ticks);
+
+/* 写入当前填充缓冲，超出 RINGBACK_BATCH_MAX_SAMPLES 的部分丢弃并返回 -1 */
+int ringback_batch_push(ringback_batch_t *b, int slot, const int16_t *samples, int count);
+/* 切换填充缓冲，之后的 run 处理刚切出的缓冲 */
+void ringback_batch_swap(ringback_batch_t *b);
+/* 对切出缓冲中所有有数据的组执行计算 (可在锁外调用) */
+void ringback_batch_run(ringback_batch_t *b);
+/* 发布 run 的结果 */
+void ringback_batch_publish(ringback_batch_t *b);
+/* 槽位最近一轮的结果 (count 为 0 表示该轮无数据) */
+const ringback_batch_result_t *ringback_batch_result(const ringback_batch_t *b, int slot);
+/* 按轮次顺序取出槽位尚未取走的有数据结果，最多 max 个，返回个数 */
+int ringback_batch_take(ringback_batch_t *b, int slot, ringback_batch_result_t *out, int max);
+
+/*
+ * 浮点参考实现 (原 double 路径)
+ * 保留用于精度对比和基准测试，媒体回调不再使用。
+ */
+typedef struct ringback_goertzel_ref {
+    double coef;
+    double s1, s2;
+    int count;
+} ringback_goertzel_ref_t;
+
+void ringback_ref_goertzel_init(ringback_goertzel_ref_t *g, double freq, int rate);
+void ringback_ref_goertzel_process(ringback_goertzel_ref_t *g, const int16_t *samples, int count);
+double ringback_ref_goertzel_power(const ringback_goertzel_ref_t *g);
+double ringback_ref_frame_energy(const int16_t *samples, int count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* RINGBACK_DSP_H */
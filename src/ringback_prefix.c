@@ -0,0 +1,90 @@
+/*
+ * ringback_prefix - 号码前缀字典树实现
+ */
+
+#include "ringback_prefix.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static int new_node(ringback_prefix_t *t)
+{
+    if (t->nnodes == t->capacity) {
+        int cap = t->capacity ? t->capacity * 2 : 64;
+        ringback_prefix_node_t *nodes = realloc(t->nodes, cap * sizeof(*nodes));
+        if (!nodes) {
+            return -1;
+        }
+        t->nodes = nodes;
+        t->capacity = cap;
+    }
+    memset(&t->nodes[t->nnodes], 0, sizeof(t->nodes[0]));
+    t->nodes[t->nnodes].value = -1;
+    return t->nnodes++;
+}
+
+int ringback_prefix_init(ringback_prefix_t *t)
+{
+    memset(t, 0, sizeof(*t));
+    return new_node(t) == 0 ? 0 : -1;
+}
+
+void ringback_prefix_destroy(ringback_prefix_t *t)
+{
+    free(t->nodes);
+    memset(t, 0, sizeof(*t));
+}
+
+int ringback_prefix_add(ringback_prefix_t *t, const char *prefix, int value)
+{
+    int n = 0;
+
+    if (*prefix == '+') {
+        prefix++;
+    }
+    if (!*prefix) {
+        return -1;
+    }
+
+    for (; *prefix; prefix++) {
+        int d = *prefix - '0';
+        if (d < 0 || d > 9) {
+            return -1;
+        }
+        if (!t->nodes[n].child[d]) {
+            int c = new_node(t);
+            if (c < 0) {
+                return -1;
+            }
+            t->nodes[n].child[d] = c;
+        }
+        n = t->nodes[n].child[d];
+    }
+
+    t->nodes[n].value = value;
+    return 0;
+}
+
+int ringback_prefix_lookup(const ringback_prefix_t *t, const char *number)
+{
+    int n = 0, found = -1;
+
+    if (!t->nodes || !number) {
+        return -1;
+    }
+    if (*number == '+') {
+        number++;
+    }
+
+    for (; *number; number++) {
+        int d = *number - '0';
+        if (d < 0 || d > 9 || !(n = t->nodes[n].child[d])) {
+            break;
+        }
+        if (t->nodes[n].value >= 0) {
+            found = t->nodes[n].value;
+        }
+    }
+
+    return found;
+}
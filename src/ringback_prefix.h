@@ -0,0 +1,39 @@
+/*
+ * ringback_prefix - 号码前缀字典树
+ *
+ * 按 E.164 被叫号码做最长前缀匹配，用于呼叫时一次查找选出信号音方案和参数。
+ * 节点存放在一块连续数组中，每个节点 10 个数字子节点下标，
+ * 查找只沿号码逐位下行，开销与前缀数量无关。
+ *
+ * 不依赖 FreeSWITCH，可单独编译测试。
+ */
+
+#ifndef RINGBACK_PREFIX_H
+#define RINGBACK_PREFIX_H
+
+#include <stdint.h>
+
+typedef struct ringback_prefix_node {
+    int32_t child[10];      /* 子节点下标，0 表示无 (根节点不会成为子节点) */
+    int32_t value;          /* 以此节点结尾的前缀对应的值，-1 表示无 */
+} ringback_prefix_node_t;
+
+typedef struct ringback_prefix {
+    ringback_prefix_node_t *nodes;
+    int nnodes;
+    int capacity;
+} ringback_prefix_t;
+
+int ringback_prefix_init(ringback_prefix_t *t);
+void ringback_prefix_destroy(ringback_prefix_t *t);
+
+/*
+ * 添加前缀 (只含数字，允许前导 '+')，重复添加覆盖旧值。
+ * 成功返回 0，前缀非法或内存不足返回 -1
+ */
+int ringback_prefix_add(ringback_prefix_t *t, const char *prefix, int value);
+
+/* 最长前缀匹配，忽略前导 '+'，遇到非数字停止。无匹配返回 -1 */
+int ringback_prefix_lookup(const ringback_prefix_t *t, const char *number);
+
+#endif /* RINGBACK_PREFIX_H */
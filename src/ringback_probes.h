@@ -0,0 +1,57 @@
+/*
+ * ringback_probes - USDT 静态探针
+ *
+ * 探针编译为一条 nop 和 .note.stapsdt 中的描述，bpftrace/perf/SystemTap 挂载时才替换为断点。
+ * 每个探针带一个信号量 (挂载工具附加时加一)，参数需要额外计算的 (取 UUID、扫描特征边沿)
+ * 先用 RINGBACK_PROBE_ENABLED 判断，未挂载时热路径只多一次内存读。
+ *
+ * 没有 <sys/sdt.h> (systemtap-sdt-dev / systemtap-sdt-devel) 或定义了 RINGBACK_NO_PROBES 时
+ * 探针全部展开为空。
+ *
+ *   bpftrace -e 'usdt:/usr/local/freeswitch/mod/mod_ringback.so:ringback:verdict
+ *                { printf("%s %s %d ms\n", str(arg0), str(arg1), arg3); }'
+ */
+
+#ifndef RINGBACK_PROBES_H
+#define RINGBACK_PROBES_H
+
+#if !defined(RINGBACK_NO_PROBES) && defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#define RINGBACK_PROBES 1
+#endif
+#endif
+
+#ifdef RINGBACK_PROBES
+
+#define _SDT_HAS_SEMAPHORES 1
+#include <sys/sdt.h>
+
+/* 信号量定义，每个探针在一个编译单元中定义一次；sdt.h 按 provider_name_semaphore 引用 */
+#define RINGBACK_PROBE_SEMAPHORE(name) \
+    __extension__ unsigned short ringback_##name##_semaphore __attribute__((unused, section(".probes")))
+
+#define RINGBACK_PROBE_ENABLED(name) \
+    __builtin_expect(*(volatile unsigned short *)&ringback_##name##_semaphore, 0)
+
+#define RINGBACK_PROBE4(name, a1, a2, a3, a4) \
+    do { if (RINGBACK_PROBE_ENABLED(name)) STAP_PROBE4(ringback, name, a1, a2, a3, a4); } while (0)
+#define RINGBACK_PROBE5(name, a1, a2, a3, a4, a5) \
+    do { if (RINGBACK_PROBE_ENABLED(name)) STAP_PROBE5(ringback, name, a1, a2, a3, a4, a5); } while (0)
+#define RINGBACK_PROBE6(name, a1, a2, a3, a4, a5, a6) \
+    do { if (RINGBACK_PROBE_ENABLED(name)) STAP_PROBE6(ringback, name, a1, a2, a3, a4, a5, a6); } while (0)
+
+#else
+
+#define RINGBACK_PROBE_SEMAPHORE(name) struct ringback_probe_##name##_unused
+#define RINGBACK_PROBE_ENABLED(name) 0
+/* 参数不求值，只在 sizeof 中引用，避免只给探针用的变量报未使用 */
+#define RINGBACK_PROBE4(name, a1, a2, a3, a4) \
+    do { (void)sizeof(a1); (void)sizeof(a2); (void)sizeof(a3); (void)sizeof(a4); } while (0)
+#define RINGBACK_PROBE5(name, a1, a2, a3, a4, a5) \
+    do { RINGBACK_PROBE4(name, a1, a2, a3, a4); (void)sizeof(a5); } while (0)
+#define RINGBACK_PROBE6(name, a1, a2, a3, a4, a5, a6) \
+    do { RINGBACK_PROBE5(name, a1, a2, a3, a4, a5); (void)sizeof(a6); } while (0)
+
+#endif
+
+#endif /* RINGBACK_PROBES_H */
@@ -0,0 +1,58 @@
+/*
+ * ringback_ring - 单生产者单消费者帧环形队列实现
+ */
+
+#include "ringback_ring.h"
+
+#include <string.h>
+
+#define SLOT_MASK (RINGBACK_RING_SLOTS - 1)
+
+void ringback_ring_init(ringback_ring_t *r)
+{
+    r->head = r->tail = 0;
+    r->dropped = 0;
+}
+
+int ringback_ring_push(ringback_ring_t *r, const void *data, uint32_t datalen, uint32_t samples, uint32_t rate,
+                       uint32_t timestamp, uint16_t seq, uint32_t flags)
+{
+    uint32_t head = __atomic_load_n(&r->head, __ATOMIC_RELAXED);
+    ringback_ring_frame_t *f;
+
+    if (datalen > RINGBACK_RING_FRAME_BYTES) {
+        return RINGBACK_RING_TOO_LONG;
+    }
+    if (head - __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE) >= RINGBACK_RING_SLOTS) {
+        r->dropped++;
+        return RINGBACK_RING_FULL;
+    }
+
+    f = &r->slots[head & SLOT_MASK];
+    if (datalen) {
+        memcpy(f->data, data, datalen);
+    }
+    f->datalen = datalen;
+    f->samples = samples;
+    f->rate = rate;
+    f->timestamp = timestamp;
+    f->seq = seq;
+    f->flags = flags;
+    __atomic_store_n(&r->head, head + 1, __ATOMIC_RELEASE);
+    return RINGBACK_RING_OK;
+}
+
+const ringback_ring_frame_t *ringback_ring_peek(ringback_ring_t *r)
+{
+    uint32_t tail = __atomic_load_n(&r->tail, __ATOMIC_RELAXED);
+
+    if (tail == __atomic_load_n(&r->head, __ATOMIC_ACQUIRE)) {
+        return NULL;
+    }
+    return &r->slots[tail & SLOT_MASK];
+}
+
+void ringback_ring_pop(ringback_ring_t *r)
+{
+    __atomic_store_n(&r->tail, r->tail + 1, __ATOMIC_RELEASE);
+}
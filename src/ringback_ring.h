@@ -0,0 +1,62 @@
+/*
+ * ringback_ring - 单生产者单消费者帧环形队列
+ *
+ * 卸载模式下媒体回调只把帧拷进本通道的环形队列就返回，由工作线程取出分析。
+ * 槽位预分配、定长，生产者只写 head、消费者只写 tail (各占一条缓存行)，
+ * 用 acquire/release 原子操作同步，无锁、无系统调用。队列满时丢弃新帧并计数；
+ * 超过槽位的帧不入队也不计丢弃，由调用方改在本线程分析。
+ * 消费者可以换线程 (工作窃取)，但同一时刻只能有一个，由调用方保证。
+ *
+ * 不依赖 FreeSWITCH，可单独编译测试。
+ */
+
+#ifndef RINGBACK_RING_H
+#define RINGBACK_RING_H
+
+#include <stdint.h>
+
+#define RINGBACK_RING_SLOTS       8         /* 2 的幂，160ms @ 20ms 帧 */
+#define RINGBACK_RING_FRAME_BYTES 5760      /* 60ms L16 @ 48kHz，常见编码的最大 ptime */
+
+/* ringback_ring_push 返回值 */
+enum {
+    RINGBACK_RING_OK = 0,
+    RINGBACK_RING_FULL = -1,    /* 队列满，丢弃并计入 dropped */
+    RINGBACK_RING_TOO_LONG = -2 /* 超过 RINGBACK_RING_FRAME_BYTES，未入队，不计丢弃 */
+};
+
+typedef struct ringback_ring_frame {
+    uint32_t datalen;
+    uint32_t samples;
+    uint32_t rate;
+    uint32_t timestamp;
+    uint32_t flags;
+    uint16_t seq;
+    uint8_t data[RINGBACK_RING_FRAME_BYTES];
+} ringback_ring_frame_t;
+
+typedef struct ringback_ring {
+    volatile uint32_t head;     /* 生产者写入位置 */
+    char pad0[64 - sizeof(uint32_t)];
+    volatile uint32_t tail;     /* 消费者读取位置 */
+    char pad1[64 - sizeof(uint32_t)];
+    uint32_t dropped;           /* 队列满丢弃的帧数 (生产者写) */
+    ringback_ring_frame_t slots[RINGBACK_RING_SLOTS];
+} ringback_ring_t;
+
+void ringback_ring_init(ringback_ring_t *r);
+
+/* 生产者：拷入一帧 (datalen 为 0 表示无载荷，如 CNG)，返回 RINGBACK_RING_* */
+int ringback_ring_push(ringback_ring_t *r, const void *data, uint32_t datalen, uint32_t samples, uint32_t rate,
+                       uint32_t timestamp, uint16_t seq, uint32_t flags);
+
+/* 消费者：最早的一帧，空时返回 NULL；用完后 ringback_ring_pop 归还槽位 */
+const ringback_ring_frame_t *ringback_ring_peek(ringback_ring_t *r);
+void ringback_ring_pop(ringback_ring_t *r);
+
+static inline int ringback_ring_empty(const ringback_ring_t *r)
+{
+    return __atomic_load_n(&r->head, __ATOMIC_ACQUIRE) == __atomic_load_n(&r->tail, __ATOMIC_RELAXED);
+}
+
+#endif /* RINGBACK_RING_H */
@@ -0,0 +1,142 @@
+/*
+ * ringback_stats - 热路径计数器与延迟直方图实现
+ */
+
+#include "ringback_stats.h"
+
+#include <string.h>
+#include <time.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define RINGBACK_STATS_TSC
+#include <x86intrin.h>
+#endif
+
+static const char *const counter_names[RINGBACK_STAT_COUNTERS] = {
+    "frames", "started", "stopped", "verdicts_busy", "verdicts_ringback", "verdicts_congestion",
+    "verdicts_other", "early_verdicts", "timeouts", "hangups", "detached_answer", "detached_bridge",
+    "detached_hangup",
+};
+
+/* 纳秒 = ticks * clock_mult >> 32 */
+static uint64_t clock_mult = UINT64_C(1) << 32;
+
+const char *ringback_stat_name(int counter)
+{
+    return counter >= 0 && counter < RINGBACK_STAT_COUNTERS ? counter_names[counter] : "unknown";
+}
+
+static uint64_t mono_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+#ifndef RINGBACK_STATS_TSC
+static int thread_shard(void)
+{
+    static __thread int shard = -1;
+    static int next;
+
+    if (shard < 0) {
+        shard = __atomic_fetch_add(&next, 1, __ATOMIC_RELAXED) % RINGBACK_STATS_SHARDS;
+    }
+    return shard;
+}
+#endif
+
+uint64_t ringback_stats_clock(int *shard)
+{
+#ifdef RINGBACK_STATS_TSC
+    unsigned int aux;
+    uint64_t t = __rdtscp(&aux);
+    if (shard) {
+        /* Linux 的 TSC_AUX 低 12 位为 CPU 编号 */
+        *shard = (int)((aux & 0xfff) % RINGBACK_STATS_SHARDS);
+    }
+    return t;
+#else
+    if (shard) {
+        *shard = thread_shard();
+    }
+    return mono_ns();
+#endif
+}
+
+int ringback_stats_shard(void)
+{
+    int shard;
+    ringback_stats_clock(&shard);
+    return shard;
+}
+
+void ringback_stats_clock_init(void)
+{
+#ifdef RINGBACK_STATS_TSC
+    uint64_t ns0 = mono_ns(), t0 = ringback_stats_clock(NULL), ns1, t1;
+    struct timespec ts = { 0, 10000000 };
+
+    nanosleep(&ts, NULL);
+    ns1 = mono_ns();
+    t1 = ringback_stats_clock(NULL);
+    if (t1 > t0 && ns1 > ns0) {
+        clock_mult = (uint64_t)((double)(ns1 - ns0) / (double)(t1 - t0) * 4294967296.0);
+    }
+#endif
+}
+
+uint64_t ringback_stats_clock_ns(uint64_t ticks)
+{
+    return (uint64_t)(((unsigned __int128)ticks * clock_mult) >> 32);
+}
+
+static void hist_merge(ringback_hist_t *dst, const ringback_hist_t *src)
+{
+    int i;
+
+    dst->count += __atomic_load_n(&src->count, __ATOMIC_RELAXED);
+    dst->sum += __atomic_load_n(&src->sum, __ATOMIC_RELAXED);
+    for (i = 0; i < RINGBACK_HIST_BUCKETS; i++) {
+        dst->bucket[i] += __atomic_load_n(&src->bucket[i], __ATOMIC_RELAXED);
+    }
+}
+
+void ringback_stats_sum(const ringback_stats_t *s, ringback_stats_shard_t *out)
+{
+    int i, c;
+
+    memset(out, 0, sizeof(*out));
+    for (i = 0; i < RINGBACK_STATS_SHARDS; i++) {
+        const ringback_stats_shard_t *sh = &s->shard[i];
+        for (c = 0; c < RINGBACK_STAT_COUNTERS; c++) {
+            out->counter[c] += __atomic_load_n(&sh->counter[c], __ATOMIC_RELAXED);
+        }
+        hist_merge(&out->callback_ns, &sh->callback_ns);
+        hist_merge(&out->verdict_ms, &sh->verdict_ms);
+    }
+}
+
+uint64_t ringback_hist_quantile(const ringback_hist_t *h, double q)
+{
+    uint64_t total = 0, need, acc = 0;
+    int i;
+
+    for (i = 0; i < RINGBACK_HIST_BUCKETS; i++) {
+        total += h->bucket[i];
+    }
+    if (!total) {
+        return 0;
+    }
+    need = (uint64_t)(q * (double)total + 0.5);
+    if (need < 1) {
+        need = 1;
+    }
+    for (i = 0; i < RINGBACK_HIST_BUCKETS; i++) {
+        acc += h->bucket[i];
+        if (acc >= need) {
+            return ringback_hist_bound(i);
+        }
+    }
+    return ringback_hist_bound(RINGBACK_HIST_BUCKETS - 1);
+}
@@ -0,0 +1,100 @@
+/*
+ * ringback_stats - 热路径计数器与延迟直方图
+ *
+ * 计数器和直方图按 CPU 分片 (每片独占缓存行)，热路径只对当前 CPU 的分片做
+ * relaxed 原子加，不加锁、不共享缓存行；读取时把各分片相加，读端与写端互不阻塞，
+ * 汇总值是近似快照。x86 上用 rdtscp 同时取 TSC 和 CPU 编号 (Linux 的 TSC_AUX)，
+ * 启动时按单调时钟校准 TSC 频率；其他平台用单调时钟，分片按线程散列。
+ *
+ * 直方图按 2 的幂分桶：第 i 桶为 [2^(i-1), 2^i)，第 0 桶只含 0。
+ *
+ * 不依赖 FreeSWITCH，可单独编译测试。
+ */
+
+#ifndef RINGBACK_STATS_H
+#define RINGBACK_STATS_H
+
+#include <stdint.h>
+
+#define RINGBACK_STATS_SHARDS 64
+#define RINGBACK_HIST_BUCKETS 32
+
+enum {
+    RINGBACK_STAT_FRAMES,           /* 分析的帧数 (卸载模式为工作线程处理的帧) */
+    RINGBACK_STAT_STARTED,          /* 启动的检测 */
+    RINGBACK_STAT_STOPPED,          /* 结束的检测，STARTED - STOPPED 即当前检测中的通道数 */
+    RINGBACK_STAT_VERDICT_BUSY,
+    RINGBACK_STAT_VERDICT_RINGBACK,
+    RINGBACK_STAT_VERDICT_CONGESTION,
+    RINGBACK_STAT_VERDICT_OTHER,
+    RINGBACK_STAT_EARLY,            /* 置信度早判 (首次判定中未完整匹配的) */
+    RINGBACK_STAT_TIMEOUTS,
+    RINGBACK_STAT_HANGUPS,          /* 自动挂断 */
+    RINGBACK_STAT_ANSWERED,         /* 接通/桥接/挂机时摘除 */
+    RINGBACK_STAT_BRIDGED,
+    RINGBACK_STAT_HUNGUP,
+    RINGBACK_STAT_COUNTERS
+};
+
+typedef struct ringback_hist {
+    uint64_t count;
+    uint64_t sum;
+    uint64_t bucket[RINGBACK_HIST_BUCKETS];
+} ringback_hist_t;
+
+typedef struct ringback_stats_shard {
+    uint64_t counter[RINGBACK_STAT_COUNTERS];
+    ringback_hist_t callback_ns;    /* 每帧媒体回调耗时 */
+    ringback_hist_t verdict_ms;     /* 启动到首次判定的时长 */
+} __attribute__((aligned(64))) ringback_stats_shard_t;
+
+typedef struct ringback_stats {
+    ringback_stats_shard_t shard[RINGBACK_STATS_SHARDS];
+} ringback_stats_t;
+
+/* 计数器名称 (蛇形，用于 API 输出) */
+const char *ringback_stat_name(int counter);
+
+/* 校准时钟，进程内调用一次 (约 10ms) */
+void ringback_stats_clock_init(void);
+
+/* 当前时钟读数 (x86 为 TSC)，shard 非 NULL 时写入所在 CPU 对应的分片 */
+uint64_t ringback_stats_clock(int *shard);
+
+/* 两次 ringback_stats_clock 读数之差换算为纳秒 */
+uint64_t ringback_stats_clock_ns(uint64_t ticks);
+
+/* 桶 i 的上界 (含)：2^i - 1 */
+static inline uint64_t ringback_hist_bound(int i)
+{
+    return i >= 64 ? UINT64_MAX : (UINT64_C(1) << i) - 1;
+}
+
+static inline int ringback_hist_bucket(uint64_t v)
+{
+    int i = v ? 64 - __builtin_clzll(v) : 0;
+    return i < RINGBACK_HIST_BUCKETS ? i : RINGBACK_HIST_BUCKETS - 1;
+}
+
+static inline void ringback_hist_add(ringback_hist_t *h, uint64_t v)
+{
+    __atomic_add_fetch(&h->count, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&h->sum, v, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&h->bucket[ringback_hist_bucket(v)], 1, __ATOMIC_RELAXED);
+}
+
+static inline void ringback_stats_inc(ringback_stats_t *s, int shard, int counter)
+{
+    __atomic_add_fetch(&s->shard[shard].counter[counter], 1, __ATOMIC_RELAXED);
+}
+
+/* 分片编号：没有现成的读数时按当前 CPU 取 */
+int ringback_stats_shard(void);
+
+/* 汇总所有分片 */
+void ringback_stats_sum(const ringback_stats_t *s, ringback_stats_shard_t *out);
+
+/* 分位数 q (0..1) 所在桶的上界，无样本返回 0 */
+uint64_t ringback_hist_quantile(const ringback_hist_t *h, double q);
+
+#endif /* RINGBACK_STATS_H */
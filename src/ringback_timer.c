@@ -0,0 +1,146 @@
+/*
+ * ringback_timer - 分层时间轮实现
+ */
+
+#include "ringback_timer.h"
+
+#include <string.h>
+
+#define SLOT_MASK  (RINGBACK_WHEEL_SLOTS - 1)
+#define MAX_SPAN   ((UINT64_C(1) << (RINGBACK_WHEEL_BITS * RINGBACK_WHEEL_LEVELS)) - 1)
+
+static inline void list_init(ringback_timer_t *head)
+{
+    head->next = head->prev = head;
+}
+
+static inline void list_add(ringback_timer_t *head, ringback_timer_t *t)
+{
+    t->next = head;
+    t->prev = head->prev;
+    head->prev->next = t;
+    head->prev = t;
+}
+
+static inline void list_del(ringback_timer_t *t)
+{
+    t->prev->next = t->next;
+    t->next->prev = t->prev;
+    t->next = t->prev = NULL;
+}
+
+/* 把 src 的全部节点移到 dst (dst 须为空表头)，src 置空 */
+static inline void list_splice(ringback_timer_t *src, ringback_timer_t *dst)
+{
+    if (src->next == src) {
+        list_init(dst);
+        return;
+    }
+    dst->next = src->next;
+    dst->prev = src->prev;
+    dst->next->prev = dst;
+    dst->prev->next = dst;
+    list_init(src);
+}
+
+/*
+ * 按距 now 的节拍数选层：第 l 层容纳 [64^l, 64^(l+1)) 节拍后到期的定时器，
+ * 槽位取到期节拍在该层的位。该层槽位回绕到它时，其中定时器都已在 64^l 节拍内到期
+ */
+static void wheel_insert(ringback_wheel_t *w, ringback_timer_t *t)
+{
+    uint64_t e = t->expires < w->now ? w->now : t->expires;
+    uint64_t d = e - w->now;
+    int l = 0;
+
+    if (d > MAX_SPAN) {
+        d = MAX_SPAN;
+        e = w->now + d;
+    }
+    while (l < RINGBACK_WHEEL_LEVELS - 1 && d >= (UINT64_C(1) << (RINGBACK_WHEEL_BITS * (l + 1)))) {
+        l++;
+    }
+    list_add(&w->slots[l][(e >> (RINGBACK_WHEEL_BITS * l)) & SLOT_MASK], t);
+}
+
+/* 把第 l 层的 idx 槽位下放到更低层，返回 idx (为 0 说明该层也回绕，需继续下放上一层) */
+static int cascade(ringback_wheel_t *w, int l, int idx)
+{
+    ringback_timer_t list, *t;
+
+    list_splice(&w->slots[l][idx], &list);
+    while ((t = list.next) != &list) {
+        list_del(t);
+        wheel_insert(w, t);
+    }
+    return idx;
+}
+
+void ringback_wheel_init(ringback_wheel_t *w, uint64_t now)
+{
+    int l, i;
+
+    w->now = now;
+    w->count = 0;
+    for (l = 0; l < RINGBACK_WHEEL_LEVELS; l++) {
+        for (i = 0; i < RINGBACK_WHEEL_SLOTS; i++) {
+            list_init(&w->slots[l][i]);
+        }
+    }
+}
+
+void ringback_timer_init(ringback_timer_t *t, ringback_timer_fn fn, void *arg)
+{
+    memset(t, 0, sizeof(*t));
+    t->fn = fn;
+    t->arg = arg;
+}
+
+void ringback_wheel_add(ringback_wheel_t *w, ringback_timer_t *t, uint64_t expires)
+{
+    ringback_wheel_cancel(w, t);
+    t->expires = expires;
+    wheel_insert(w, t);
+    w->count++;
+}
+
+void ringback_wheel_cancel(ringback_wheel_t *w, ringback_timer_t *t)
+{
+    if (t->prev) {
+        list_del(t);
+        w->count--;
+    }
+}
+
+int ringback_wheel_advance(ringback_wheel_t *w, uint64_t now)
+{
+    int fired = 0;
+
+    while (w->now <= now) {
+        ringback_timer_t list, *t;
+        int idx, l;
+
+        /* 空轮直接跳到目标节拍，不逐拍回绕 */
+        if (!w->count) {
+            w->now = now + 1;
+            break;
+        }
+
+        idx = (int)(w->now & SLOT_MASK);
+        for (l = 1; !idx && l < RINGBACK_WHEEL_LEVELS; l++) {
+            idx = cascade(w, l, (int)((w->now >> (RINGBACK_WHEEL_BITS * l)) & SLOT_MASK));
+        }
+
+        /* 先摘下本拍的槽位再前移，回调中加入的定时器最早落在下一拍 */
+        list_splice(&w->slots[0][w->now & SLOT_MASK], &list);
+        w->now++;
+        while ((t = list.next) != &list) {
+            list_del(t);
+            w->count--;
+            fired++;
+            t->fn(t, t->arg);
+        }
+    }
+
+    return fired;
+}
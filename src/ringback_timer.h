@@ -0,0 +1,59 @@
+/*
+ * ringback_timer - 分层时间轮
+ *
+ * 模块级定时器：所有通道的最大检测时间等截止时刻挂在同一个时间轮上，
+ * 由一个线程按固定节拍推进，媒体回调不再逐帧检查超时，没有帧的通道也能按时结束。
+ * 4 层各 64 槽 (每层跨度为上一层的 64 倍)，定时器节点嵌入调用方结构体 (侵入式双向链表)，
+ * 加入、取消均为 O(1) 且不分配内存；推进时只在低层槽位回绕时把上一层的一个槽位下放。
+ * 时间单位为调用方定义的节拍，超出最大跨度 (64^4 节拍) 的定时器按最大跨度处理。
+ *
+ * 不加锁，由调用方串行化。不依赖 FreeSWITCH，可单独编译测试。
+ */
+
+#ifndef RINGBACK_TIMER_H
+#define RINGBACK_TIMER_H
+
+#include <stdint.h>
+
+#define RINGBACK_WHEEL_BITS   6
+#define RINGBACK_WHEEL_SLOTS  (1 << RINGBACK_WHEEL_BITS)
+#define RINGBACK_WHEEL_LEVELS 4
+
+typedef struct ringback_timer ringback_timer_t;
+
+/* 到期回调，调用时定时器已摘下，可在回调中重新加入或取消其他定时器 */
+typedef void (*ringback_timer_fn)(ringback_timer_t *t, void *arg);
+
+struct ringback_timer {
+    ringback_timer_t *next;
+    ringback_timer_t *prev;     /* NULL 表示未挂在时间轮上 */
+    uint64_t expires;
+    ringback_timer_fn fn;
+    void *arg;
+};
+
+typedef struct ringback_wheel {
+    uint64_t now;               /* 下一个待处理的节拍 */
+    uint32_t count;             /* 挂着的定时器数 */
+    ringback_timer_t slots[RINGBACK_WHEEL_LEVELS][RINGBACK_WHEEL_SLOTS];    /* 各槽位链表头 */
+} ringback_wheel_t;
+
+void ringback_wheel_init(ringback_wheel_t *w, uint64_t now);
+
+void ringback_timer_init(ringback_timer_t *t, ringback_timer_fn fn, void *arg);
+
+static inline int ringback_timer_pending(const ringback_timer_t *t)
+{
+    return t->prev != 0;
+}
+
+/* 在 expires 节拍到期 (已过期的在下一次推进时到期)；已挂着时先取消，即改期 */
+void ringback_wheel_add(ringback_wheel_t *w, ringback_timer_t *t, uint64_t expires);
+
+/* 取消，未挂着时无操作 */
+void ringback_wheel_cancel(ringback_wheel_t *w, ringback_timer_t *t);
+
+/* 推进到 now (含)，依次调用到期定时器的回调，返回到期个数 */
+int ringback_wheel_advance(ringback_wheel_t *w, uint64_t now);
+
+#endif /* RINGBACK_TIMER_H */
@@ -0,0 +1,698 @@
+/*
+ * ringback_tones - 各国信号音方案与多方案并行识别实现
+ */
+
+#include "ringback_tones.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+
+/*
+ * 各国信号音 (ITU-T E.180 补充文档 / Q.35)。
+ * 调制音 (如日本回铃音 400Hz 以 16Hz 调制、印度 400Hz 以 25Hz 调制) 按载频处理；
+ * 频点须在 mod_ringback 的滤波器组中
+ */
+static const ringback_country_t countries[] = {
+    { "cn", "China", {
+        { RINGBACK_TONE_BUSY,       { 450, 0 },   "350|350" },
+        { RINGBACK_TONE_RINGBACK,   { 450, 0 },   "1000|4000" },
+        { RINGBACK_TONE_CONGESTION, { 450, 0 },   "700|700" } } },
+    { "us", "United States / NANP", {
+        { RINGBACK_TONE_BUSY,       { 480, 620 }, "500|500" },
+        { RINGBACK_TONE_RINGBACK,   { 440, 480 }, "2000|4000" },
+        { RINGBACK_TONE_CONGESTION, { 480, 620 }, "250|250" } } },
+    { "uk", "United Kingdom", {
+        { RINGBACK_TONE_BUSY,       { 400, 0 },   "375|375" },
+        { RINGBACK_TONE_RINGBACK,   { 400, 450 }, "400|200|400|2000" },
+        { RINGBACK_TONE_CONGESTION, { 400, 0 },   "400|350|225|525" } } },
+    { "de", "Germany", {
+        { RINGBACK_TONE_BUSY,       { 425, 0 },   "480|480" },
+        { RINGBACK_TONE_RINGBACK,   { 425, 0 },   "1000|4000" },
+        { RINGBACK_TONE_CONGESTION, { 425, 0 },   "240|240" } } },
+    { "fr", "France", {
+        { RINGBACK_TONE_BUSY,       { 440, 0 },   "500|500" },
+        { RINGBACK_TONE_RINGBACK,   { 440, 0 },   "1500|3500" } } },
+    { "it", "Italy", {
+        { RINGBACK_TONE_BUSY,       { 425, 0 },   "500|500" },
+        { RINGBACK_TONE_RINGBACK,   { 425, 0 },   "1000|4000" },
+        { RINGBACK_TONE_CONGESTION, { 425, 0 },   "200|200" } } },
+    { "es", "Spain", {
+        { RINGBACK_TONE_BUSY,       { 425, 0 },   "200|200" },
+        { RINGBACK_TONE_RINGBACK,   { 425, 0 },   "1500|3000" },
+        { RINGBACK_TONE_CONGESTION, { 425, 0 },   "200|200|200|200|200|600" } } },
+    { "ru", "Russia", {
+        { RINGBACK_TONE_BUSY,       { 425, 0 },   "400|400" },
+        { RINGBACK_TONE_RINGBACK,   { 425, 0 },   "800|3200" },
+        { RINGBACK_TONE_CONGESTION, { 425, 0 },   "175|175" } } },
+    { "jp", "Japan", {
+        { RINGBACK_TONE_BUSY,       { 400, 0 },   "500|500" },
+        { RINGBACK_TONE_RINGBACK,   { 400, 0 },   "1000|2000" } } },
+    { "in", "India", {
+        { RINGBACK_TONE_BUSY,       { 400, 0 },   "750|750" },
+        { RINGBACK_TONE_RINGBACK,   { 400, 0 },   "400|200|400|2000" },
+        { RINGBACK_TONE_CONGESTION, { 400, 0 },   "250|250" } } },
+    { "au", "Australia", {
+        { RINGBACK_TONE_BUSY,       { 425, 0 },   "375|375" },
+        { RINGBACK_TONE_RINGBACK,   { 400, 425 }, "400|200|400|2000" } } },
+    { "br", "Brazil", {
+        { RINGBACK_TONE_BUSY,       { 425, 0 },   "250|250" },
+        { RINGBACK_TONE_RINGBACK,   { 425, 0 },   "1000|4000" } } },
+    { "mx", "Mexico", {
+        { RINGBACK_TONE_BUSY,       { 425, 0 },   "250|250" },
+        { RINGBACK_TONE_RINGBACK,   { 425, 0 },   "1000|4000" } } },
+    { "kr", "South Korea", {
+        { RINGBACK_TONE_BUSY,       { 480, 620 }, "500|500" },
+        { RINGBACK_TONE_RINGBACK,   { 440, 480 }, "1000|2000" },
+        { RINGBACK_TONE_CONGESTION, { 480, 620 }, "300|200" } } },
+};
+#define NCOUNTRIES ((int)(sizeof(countries) / sizeof(countries[0])))
+
+int ringback_country_count(void)
+{
+    return NCOUNTRIES;
+}
+
+const ringback_country_t *ringback_country_get(int i)
+{
+    return i >= 0 && i < NCOUNTRIES ? &countries[i] : NULL;
+}
+
+const ringback_country_t *ringback_country_find(const char *code)
+{
+    int i;
+    for (i = 0; i < NCOUNTRIES; i++) {
+        if (!strcasecmp(countries[i].code, code)) {
+            return &countries[i];
+        }
+    }
+    return NULL;
+}
+
+static const char *tone_suffix(int tone)
+{
+    switch (tone) {
+    case RINGBACK_TONE_BUSY: return "busy";
+    case RINGBACK_TONE_RINGBACK: return "ringback";
+    case RINGBACK_TONE_CONGESTION: return "congestion";
+    default: return "tone";
+    }
+}
+
+void ringback_toneset_init(ringback_toneset_t *ts, const double *freqs, int nbins)
+{
+    memset(ts, 0, sizeof(*ts));
+    if (nbins > RINGBACK_BANK_MAX_BINS) {
+        nbins = RINGBACK_BANK_MAX_BINS;
+    }
+    memcpy(ts->freqs, freqs, nbins * sizeof(double));
+    ts->nbins = nbins;
+    ts->min_purity = RINGBACK_DEFAULT_MIN_PURITY;
+    ts->max_twist_db = RINGBACK_DEFAULT_MAX_TWIST_DB;
+    ts->max_harmonic_db = RINGBACK_DEFAULT_MAX_HARMONIC_DB;
+    ts->snr_db = RINGBACK_DEFAULT_SNR_DB;
+    ts->hysteresis_db = RINGBACK_DEFAULT_HYSTERESIS_DB;
+    ts->min_gap_ms = RINGBACK_DEFAULT_MIN_GAP_MS;
+}
+
+/* 特征各频点 2/3 次谐波附近的滤波器组频点 (特征自身频点除外) */
+static uint32_t harmonic_bins(const ringback_toneset_t *ts, uint32_t bins)
+{
+    uint32_t harm = 0, m = bins;
+
+    while (m) {
+        int f = __builtin_ctz(m), k, b;
+        m &= m - 1;
+        for (k = 2; k <= 3; k++) {
+            for (b = 0; b < ts->nbins; b++) {
+                if (fabs(ts->freqs[b] - k * ts->freqs[f]) <= RINGBACK_HARMONIC_TOL_HZ) {
+                    harm |= 1u << b;
+                }
+            }
+        }
+    }
+    return harm & ~bins;
+}
+
+static int find_profile(ringback_toneset_t *ts, const char *name, int create)
+{
+    int i;
+    for (i = 0; i < ts->nprofiles; i++) {
+        if (!strcasecmp(ts->profile_name[i], name)) {
+            return i;
+        }
+    }
+    if (!create || ts->nprofiles >= RINGBACK_TONESET_MAX_PROFILES) {
+        return -1;
+    }
+    snprintf(ts->profile_name[i], RINGBACK_PROFILE_NAME_LEN, "%s", name);
+    ts->nprofiles++;
+    return i;
+}
+
+static int find_sig(ringback_toneset_t *ts, uint32_t bins)
+{
+    int i;
+    for (i = 0; i < ts->nsig; i++) {
+        if (ts->sig_bins[i] == bins) {
+            return i;
+        }
+    }
+    if (ts->nsig >= RINGBACK_TONESET_MAX_SIGS) {
+        return -1;
+    }
+    ts->sig_bins[i] = bins;
+    ts->sig_harm[i] = harmonic_bins(ts, bins);
+    ts->nsig++;
+    return i;
+}
+
+int ringback_toneset_add_rule(ringback_toneset_t *ts, const char *profile, const ringback_cadence_rule_t *rule,
+                              const double *freqs, int nfreqs)
+{
+    uint32_t bins = 0;
+    int i, b, p, s, r;
+
+    if (ts->nrules >= RINGBACK_CADENCE_MAX_RULES) {
+        return -1;
+    }
+
+    for (i = 0; i < nfreqs; i++) {
+        for (b = 0; b < ts->nbins; b++) {
+            if (fabs(ts->freqs[b] - freqs[i]) < 1.0) {
+                break;
+            }
+        }
+        if (b == ts->nbins) {
+            return -1;
+        }
+        bins |= 1u << b;
+    }
+
+    if ((p = find_profile(ts, profile, 1)) < 0 || (s = find_sig(ts, bins)) < 0) {
+        return -1;
+    }
+
+    r = ts->nrules++;
+    ts->rules[r] = *rule;
+    ts->rule_sig[r] = s;
+    ts->rule_profile[r] = p;
+    ts->sig_rules[s] |= UINT64_C(1) << r;
+    ts->profile_rules[p] |= UINT64_C(1) << r;
+    return r;
+}
+
+int ringback_toneset_add_country(ringback_toneset_t *ts, const ringback_country_t *country)
+{
+    int i, j, added = 0;
+
+    for (i = 0; i < RINGBACK_COUNTRY_MAX_TONES && country->tones[i].tone; i++) {
+        const ringback_tone_plan_t *plan = &country->tones[i];
+        ringback_cadence_rule_t rule;
+        char name[RINGBACK_CADENCE_NAME_LEN];
+
+        snprintf(name, sizeof(name), "%s.%s", country->code, tone_suffix(plan->tone));
+        /* 回铃音周期长，一个周期即可判定；忙音/拥塞音要求连续两个周期 */
+        if (ringback_cadence_parse(&rule, name, plan->tone, plan->cadence,
+                                   plan->tone == RINGBACK_TONE_RINGBACK ? 1 : 2) != 0) {
+            return -1;
+        }
+        /* 标称值加容差：15% 加上边沿定位误差 20ms */
+        for (j = 0; j < rule.nseg; j++) {
+            uint32_t tol = rule.min_ms[j] * 15 / 100 + 20;
+            rule.min_ms[j] = rule.min_ms[j] > tol ? rule.min_ms[j] - tol : 0;
+            rule.max_ms[j] += tol;
+        }
+        if (ringback_toneset_add_rule(ts, country->code, &rule, plan->freq, plan->freq[1] > 0 ? 2 : 1) < 0) {
+            return -1;
+        }
+        added++;
+    }
+
+    return added;
+}
+
+int ringback_toneset_compile(ringback_toneset_t *ts)
+{
+    ts->twist_ratio = pow(10, ts->max_twist_db / 10);
+    ts->harmonic_ratio = pow(10, ts->max_harmonic_db / 10);
+    ts->snr_ratio = ts->snr_db > 0 ? pow(10, ts->snr_db / 10) : 0;
+    ts->hysteresis_ratio = pow(10, (ts->hysteresis_db > 0 ? ts->hysteresis_db : 0) / 10);
+    return ringback_cadence_compile(&ts->cadence, ts->rules, ts->nrules);
+}
+
+uint64_t ringback_toneset_select(const ringback_toneset_t *ts, const char *list)
+{
+    char buf[256], *tok, *save = NULL;
+    uint64_t rules = 0;
+    int i;
+
+    snprintf(buf, sizeof(buf), "%s", list ? list : "");
+    for (tok = strtok_r(buf, ", ", &save); tok; tok = strtok_r(NULL, ", ", &save)) {
+        if (!strcasecmp(tok, "all")) {
+            for (i = 0; i < ts->nprofiles; i++) {
+                rules |= ts->profile_rules[i];
+            }
+            continue;
+        }
+        for (i = 0; i < ts->nprofiles; i++) {
+            if (!strcasecmp(ts->profile_name[i], tok)) {
+                rules |= ts->profile_rules[i];
+                break;
+            }
+        }
+    }
+
+    return rules;
+}
+
+void ringback_tonetrack_reset(ringback_tonetrack_t *tr)
+{
+    memset(tr, 0, sizeof(*tr));
+}
+
+/*
+ * 特征频点能量占块总能量的比例。未加窗 Goertzel 对幅度 A 的单音有
+ * |X|^2 = (A*N/2)^2，而平方和为 N*A^2/2，故纯音时比值为 1
+ */
+static float sig_purity(uint32_t bins, const ringback_block_t *blk)
+{
+    double sum = 0, total = (double)blk->sumsq * blk->count / 2;
+
+    if (!bins) {
+        return 0.5f;    /* 只看能量的特征没有频率证据 */
+    }
+    while (bins) {
+        int b = __builtin_ctz(bins);
+        bins &= bins - 1;
+        sum += (double)blk->power[b];
+    }
+    return total > 0 && sum < total ? (float)(sum / total) : 1.0f;
+}
+
+/* 时长落在规则某一可接受位置的程度：范围中点为 1，边界约 0.14 */
+static float duration_fit(const ringback_cadence_rule_t *rule, uint32_t positions, uint32_t dur_ms)
+{
+    float best = 0;
+
+    while (positions) {
+        int seg = __builtin_ctz(positions) % rule->nseg;
+        float fit;
+
+        positions &= positions - 1;
+        if (rule->max_ms[seg] == UINT32_MAX) {
+            fit = 0.5f;     /* 补齐的任意长停段 */
+        } else {
+            float centre = ((float)rule->min_ms[seg] + rule->max_ms[seg]) / 2;
+            float half = ((float)rule->max_ms[seg] - rule->min_ms[seg]) / 2 + RINGBACK_CADENCE_BUCKET_MS;
+            float d = ((float)dur_ms - centre) / half;
+            fit = expf(-2.0f * d * d);
+        }
+        if (fit > best) {
+            best = fit;
+        }
+    }
+    return best;
+}
+
+#define NULL_LIKELIHOOD 0.25f
+
+/*
+ * 段结束后更新 mask 中各规则的似然比：每段似然 = 时长拟合 x 纯度 x 稳定度 (停段只看时长)，
+ * 对立假设取固定似然 NULL_LIKELIHOOD。同类信号的后验 = 该类似然比之和 / (1 + 全部似然比之和)
+ */
+static int score_segment(const ringback_toneset_t *ts, ringback_tonetrack_t *tr, uint64_t mask, int on,
+                         uint32_t dur_ms, float quality)
+{
+    uint64_t m = mask;
+    float total = 0, type_sum[8] = { 0 };
+    int best = -1, r;
+
+    while (m) {
+        r = __builtin_ctzll(m);
+        m &= m - 1;
+        if (!tr->cadence.active[r]) {
+            tr->odds[r] = 0;
+            tr->segs[r] = 0;
+            tr->fired &= ~(UINT64_C(1) << r);
+            continue;
+        }
+        if (!tr->segs[r]) {
+            tr->odds[r] = 1;
+        }
+        tr->odds[r] *= duration_fit(&ts->rules[r], tr->cadence.active[r], dur_ms) * (on ? quality : 1.0f) /
+                       NULL_LIKELIHOOD;
+        if (tr->segs[r] < UINT8_MAX) {
+            tr->segs[r]++;
+        }
+    }
+
+    /* 候选为所有仍在匹配的规则，不同频率特征之间也相互竞争 */
+    for (r = 0; r < ts->nrules; r++) {
+        if (tr->segs[r]) {
+            total += tr->odds[r];
+            type_sum[__builtin_ctz(ts->rules[r].tone | 0x80)] += tr->odds[r];
+        }
+    }
+
+    m = mask;
+    while (m) {
+        float p;
+        r = __builtin_ctzll(m);
+        m &= m - 1;
+        if (tr->segs[r] < RINGBACK_TONESET_MIN_SEGMENTS || (tr->fired & (UINT64_C(1) << r))) {
+            continue;
+        }
+        p = type_sum[__builtin_ctz(ts->rules[r].tone | 0x80)] / (1 + total);
+        if (p >= ts->confidence && (best < 0 || tr->odds[r] > tr->odds[best])) {
+            best = r;
+            tr->confidence = p;
+        }
+    }
+    if (best >= 0) {
+        tr->fired |= UINT64_C(1) << best;
+    }
+    return best;
+}
+
+/* 推进自动机；完整匹配置信度为 1，否则按需做置信度早判 */
+static int segment_end(const ringback_toneset_t *ts, ringback_tonetrack_t *tr, uint64_t mask, int s, int on,
+                       uint32_t dur_ms)
+{
+    float quality = 1;
+    int r = ringback_cadence_step_mask(&ts->cadence, &tr->cadence, mask, on, dur_ms);
+
+    if (r >= 0) {
+        tr->confidence = 1;
+        return r;
+    }
+    if (ts->confidence <= 0) {
+        return -1;
+    }
+
+    /* 响段质量 = 平均纯度 x 电平稳定度 (RMS 变异系数越大越低) */
+    if (on && tr->sig[s].nblk > 0) {
+        float n = (float)tr->sig[s].nblk;
+        float mean = tr->sig[s].rms_sum / n;
+        float var = tr->sig[s].rms_sq / n - mean * mean;
+        float cv = mean > 0 && var > 0 ? sqrtf(var) / mean : 0;
+        quality = tr->sig[s].purity_sum / n * expf(-2.0f * cv);
+    }
+
+    tr->confidence = 0;
+    return score_segment(ts, tr, mask, on, dur_ms, quality);
+}
+
+/*
+ * 频率校验，只用本块的平方和与频点功率：
+ * 特征最强频点不是别的频率的旁瓣 (不低于全部频点最强者 -6dB)，双频两分量电平接近，
+ * 谐波频点足够低 (浊音语音、削顶信号谐波丰富)，能量集中在特征频点 (噪声、音乐分散)
+ */
+static int sig_present(const ringback_toneset_t *ts, int s, const ringback_block_t *blk, int64_t peak)
+{
+    uint32_t bins = ts->sig_bins[s], m;
+    int64_t hi = 0, lo = INT64_MAX;
+
+    if (!bins) {
+        return 1;
+    }
+    for (m = bins; m; m &= m - 1) {
+        int64_t p = blk->power[__builtin_ctz(m)];
+        if (p > hi) {
+            hi = p;
+        }
+        if (p < lo) {
+            lo = p;
+        }
+    }
+    if (hi * 4 < peak || (double)lo * ts->twist_ratio < (double)hi) {
+        return 0;
+    }
+    for (m = ts->sig_harm[s]; m; m &= m - 1) {
+        if ((double)blk->power[__builtin_ctz(m)] > (double)hi * ts->harmonic_ratio) {
+            return 0;
+        }
+    }
+    return ts->min_purity <= 0 || sig_purity(bins, blk) >= ts->min_purity;
+}
+
+/*
+ * 在上一块和本块的子块包络中定位边沿 (毫秒)。起音取第一个不低于参考电平 -6dB 的子块起点，
+ * 参考为本块最强子块；收音取最后一个达到门限的子块终点，参考为上一块最强子块。
+ * 块时长按 now_ms 与 end_sample 的比例换算，无包络时返回块末时刻
+ */
+static uint32_t locate_edge(const ringback_tonetrack_t *tr, const ringback_block_t *blk, uint32_t now_ms, int on)
+{
+    const float *env[2] = { tr->prev_env, blk->env };
+    uint64_t start[2], end_us = (uint64_t)now_ms * 1000, t_us = 0;
+    uint32_t step[2], dur_us;
+    int n[2], i, k, found = 0;
+    float ref = 0, th;
+
+    if (!blk->env_n || !blk->end_sample) {
+        return now_ms;
+    }
+    dur_us = (uint32_t)(end_us * blk->count / blk->end_sample);
+    n[1] = blk->env_n;
+    start[1] = end_us - dur_us;
+    step[1] = dur_us / n[1];
+
+    /* 上一块与本块相接 (误差 1ms 内) 才参与 */
+    n[0] = 0;
+    start[0] = step[0] = 0;
+    if (tr->prev_env_n && tr->prev_end_us + 1000 >= start[1] && tr->prev_end_us <= start[1] + 1000) {
+        n[0] = tr->prev_env_n;
+        start[0] = tr->prev_end_us - tr->prev_dur_us;
+        step[0] = tr->prev_dur_us / n[0];
+    }
+
+    /* 起音以本块为参考电平，收音以上一块为参考 (没有上一块时用本块) */
+    i = on || !n[0] ? 1 : 0;
+    for (k = 0; k < n[i]; k++) {
+        if (env[i][k] > ref) {
+            ref = env[i][k];
+        }
+    }
+    th = ref / 4;
+    if (th < tr->noise_floor * 2) {
+        th = (float)(tr->noise_floor * 2);
+    }
+
+    for (i = 0; i < 2; i++) {
+        for (k = 0; k < n[i]; k++) {
+            if (env[i][k] >= th) {
+                t_us = start[i] + (on ? k : k + 1) * step[i];
+                found = 1;
+                if (on) {
+                    break;
+                }
+            }
+        }
+        if (on && found) {
+            break;
+        }
+    }
+    if (!found) {
+        return now_ms;
+    }
+    t_us = (t_us + 500) / 1000;
+    return t_us > 0 ? (uint32_t)t_us : 1;
+}
+
+int ringback_tonetrack_block(const ringback_toneset_t *ts, ringback_tonetrack_t *tr, uint64_t rules,
+                             const ringback_block_t *blk, int threshold, uint32_t now_ms)
+{
+    double level = blk->count > 0 ? (double)blk->sumsq / blk->count : 0;
+    double on_level = (double)threshold * threshold;
+    int64_t peak = 0;
+    int s, b, best = -1, any_on = 0;
+    float best_conf = 0;
+
+    if (ts->snr_ratio > 0 && tr->noise_floor * ts->snr_ratio > on_level) {
+        on_level = tr->noise_floor * ts->snr_ratio;
+    }
+
+    for (b = 0; b < ts->nbins; b++) {
+        if (blk->power[b] > peak) {
+            peak = blk->power[b];
+        }
+    }
+
+    for (s = 0; s < ts->nsig; s++) {
+        uint64_t mask = ts->sig_rules[s] & rules;
+        ringback_sigtrack_t *sg = &tr->sig[s];
+        int on, r = -1;
+
+        if (!mask) {
+            continue;
+        }
+
+        /* 施密特触发：已在响段中时用较低的收音门限 */
+        on = level > (sg->in_tone ? on_level / ts->hysteresis_ratio : on_level) && sig_present(ts, s, blk, peak);
+
+        if (on && !sg->in_tone && !sg->edge_ms) {
+            sg->nblk = 0;
+            sg->rms_sum = sg->rms_sq = sg->purity_sum = 0;
+        }
+        if (on) {
+            float rms = (float)sqrt(level);
+            sg->nblk++;
+            sg->rms_sum += rms;
+            sg->rms_sq += rms * rms;
+            sg->purity_sum += sig_purity(ts->sig_bins[s], blk);
+        }
+
+        if (on == sg->in_tone) {
+            sg->edge_ms = 0;    /* 短暂翻转已恢复，桥接 */
+        } else {
+            if (!sg->edge_ms) {
+                sg->edge_ms = locate_edge(tr, blk, now_ms, on);
+            }
+            if (now_ms - sg->edge_ms >= ts->min_gap_ms) {
+                uint32_t t = sg->edge_ms;
+                sg->edge_ms = 0;
+                sg->in_tone = on;
+                if (on) {
+                    if (sg->silence_start_ms > 0) {
+                        r = segment_end(ts, tr, mask, s, 0, t - sg->silence_start_ms);
+                    }
+                    sg->tone_start_ms = t;
+                } else {
+                    r = segment_end(ts, tr, mask, s, 1, t - sg->tone_start_ms);
+                    sg->silence_start_ms = t;
+                }
+            }
+        }
+        if (!on && !sg->in_tone && sg->silence_start_ms == 0) {
+            sg->silence_start_ms = now_ms;
+        }
+        any_on |= on || sg->in_tone;
+
+        if (r >= 0 && (best < 0 || best_conf < tr->confidence || (best_conf == tr->confidence && r < best))) {
+            best = r;
+            best_conf = tr->confidence;
+        }
+    }
+
+    /*
+     * 噪声基底 EWMA：非有音块下降快 (1/4)、上升慢 (1/64)，有音块只允许下拉。
+     * 噪声本身高于起音门限时会一直停在"响"，EWMA 无从更新：此时窗口内最安静的块
+     * 都高于基底，说明基底被低估，直接抬到窗口最小值
+     */
+    if (!any_on) {
+        if (!tr->noise_valid) {
+            tr->noise_floor = level;
+            tr->noise_valid = 1;
+        } else {
+            tr->noise_floor += (level - tr->noise_floor) / (level < tr->noise_floor ? 4 : 64);
+        }
+    } else if (level < tr->noise_floor) {
+        tr->noise_floor += (level - tr->noise_floor) / 4;
+    }
+    if (!tr->noise_blocks++ || level < tr->noise_min) {
+        tr->noise_min = level;
+    }
+    if (now_ms - tr->noise_window_ms >= RINGBACK_NOISE_WINDOW_MS) {
+        if (tr->noise_min > tr->noise_floor) {
+            tr->noise_floor = tr->noise_min;
+        }
+        tr->noise_blocks = 0;
+        tr->noise_window_ms = now_ms;
+    }
+
+    tr->prev_env_n = blk->env_n;
+    if (blk->env_n && blk->end_sample) {
+        tr->prev_end_us = (uint64_t)now_ms * 1000;
+        tr->prev_dur_us = (uint32_t)(tr->prev_end_us * blk->count / blk->end_sample);
+        memcpy(tr->prev_env, blk->env, blk->env_n * sizeof(float));
+    }
+
+    tr->confidence = best_conf;
+    return best;
+}
+
+int ringback_monitor_start(ringback_monitor_t *m, const ringback_toneset_t *ts, const ringback_tonetrack_t *tr,
+                           int r, uint32_t now_ms)
+{
+    const ringback_cadence_rule_t *rule = &ts->rules[r];
+    const ringback_sigtrack_t *sg = &tr->sig[ts->rule_sig[r]];
+    double mean;
+    int i;
+
+    memset(m, 0, sizeof(*m));
+    if (!sg->nblk) {
+        return -1;
+    }
+    mean = sg->rms_sum / sg->nblk;
+    m->on_level = mean * mean;
+    /* 停段不高于噪声基底 +6dB，也不高于响段 -12dB 以上 */
+    m->off_level = tr->noise_floor * 4;
+    if (m->off_level < m->on_level / 16) {
+        m->off_level = m->on_level / 16;
+    }
+
+    for (i = 0; i < rule->nseg; i++) {
+        uint32_t *max = i % 2 ? &m->max_off_ms : &m->max_on_ms;
+        uint32_t ms = rule->max_ms[i] > RINGBACK_CADENCE_MAX_MS ? RINGBACK_CADENCE_MAX_MS : rule->max_ms[i];
+        if (ms > *max) {
+            *max = ms;
+        }
+    }
+    m->max_on_ms += RINGBACK_MONITOR_SLACK_MS;
+    m->max_off_ms += RINGBACK_MONITOR_SLACK_MS;
+
+    m->in_tone = sg->in_tone;
+    m->since_ms = now_ms;
+    m->active = 1;
+    return 0;
+}
+
+int ringback_monitor_check(ringback_monitor_t *m, const uint64_t *seg, int count, uint32_t now_ms)
+{
+    uint64_t total = 0, lo = UINT64_MAX, hi = 0;
+    double level;
+    int i, cls;
+
+    if (!m->active || count < RINGBACK_MONITOR_SEGS) {
+        return 0;
+    }
+    for (i = 0; i < RINGBACK_MONITOR_SEGS; i++) {
+        total += seg[i];
+        if (seg[i] < lo) {
+            lo = seg[i];
+        }
+        if (seg[i] > hi) {
+            hi = seg[i];
+        }
+    }
+    level = (double)total / count;
+
+    /* 1 响，0 停，-1 异常 */
+    if (level <= m->off_level) {
+        cls = 0;
+    } else if (level * 4 >= m->on_level && level <= m->on_level * 4 && hi <= lo * 4) {
+        cls = 1;
+    } else {
+        cls = -1;
+    }
+
+    if (cls < 0) {
+        if (++m->anomalies < 2) {
+            return 0;
+        }
+    } else {
+        m->anomalies = 0;
+        if (cls != m->in_tone) {
+            m->in_tone = cls;
+            m->since_ms = now_ms;
+            return 0;
+        }
+        if (now_ms - m->since_ms <= (cls ? m->max_on_ms : m->max_off_ms)) {
+            return 0;
+        }
+    }
+
+    m->active = 0;
+    return 1;
+}
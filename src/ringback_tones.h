@@ -0,0 +1,223 @@
+/*
+ * ringback_tones - 各国信号音方案与多方案并行识别
+ *
+ * 内置按 ITU-T E.180 补充文档整理的各国忙音/回铃音/拥塞音频率与时序。
+ * 一个通道可同时挂多个候选方案：所有方案共用同一个滤波器组输出，
+ * 按"频率特征" (单频、双频或只看能量) 去重后各自切分响/停段，
+ * 再送入同一张时序自动机，只推进该通道选中的规则。
+ *
+ * 有音判定除能量门限外做真正的频率校验 (纯度、双频扭曲、谐波)，
+ * 都只用滤波器组同一遍得到的平方和与频点功率，语音、音乐、线路噪声不再算作有音。
+ * 能量门限相对每路通道的噪声基底 (EWMA) 设定，起音/收音分别取不同门限 (施密特触发)，
+ * 短于 min_gap_ms 的掉音或毛刺 (丢包、CNG 帧) 被桥接，不会切断响/停段。
+ * 响停边沿按块内子块能量包络定位到约 1ms，而不是取块边界 (20ms 量化)。
+ *
+ * 自动机要求完整周期才判定。开启置信度早判后，每段结束时按时长落在规则
+ * 范围内的位置、频率纯度和电平稳定度给仍在匹配的规则累计似然比，
+ * 同类信号的后验概率达到阈值即提前判定，忙音通常第一个周期即可出结果。
+ *
+ * 不依赖 FreeSWITCH，可单独编译测试。
+ */
+
+#ifndef RINGBACK_TONES_H
+#define RINGBACK_TONES_H
+
+#include <stdint.h>
+
+#include "ringback_dsp.h"
+#include "ringback_cadence.h"
+
+/* 信号音类型定义 (兼容 mod_da2) */
+#define RINGBACK_TONE_BUSY           0x01
+#define RINGBACK_TONE_RINGBACK       0x02
+#define RINGBACK_TONE_COLORRINGBACK  0x04
+#define RINGBACK_TONE_CONGESTION     0x08
+#define RINGBACK_TONE_SILENCE        0x20
+#define RINGBACK_TONE_450HZ          0x40
+
+/*
+ * 内置国家方案
+ */
+
+#define RINGBACK_COUNTRY_MAX_TONES 3
+
+typedef struct ringback_tone_plan {
+    int tone;               /* RINGBACK_TONE_*，0 表示空位 */
+    double freq[2];         /* 频率 (Hz)，单频时 freq[1] 为 0 */
+    const char *cadence;    /* 标称时长 "响|停|..." (ms)，编译时加容差 */
+} ringback_tone_plan_t;
+
+typedef struct ringback_country {
+    const char *code;       /* ISO 3166-1 alpha-2，小写 */
+    const char *name;
+    ringback_tone_plan_t tones[RINGBACK_COUNTRY_MAX_TONES];
+} ringback_country_t;
+
+int ringback_country_count(void);
+const ringback_country_t *ringback_country_get(int i);
+const ringback_country_t *ringback_country_find(const char *code);
+
+/*
+ * 编译后的方案集合 (只读，可被多路通道共享)
+ */
+
+#define RINGBACK_TONESET_MAX_SIGS     12
+#define RINGBACK_TONESET_MAX_PROFILES 32
+#define RINGBACK_PROFILE_NAME_LEN     16
+#define RINGBACK_TONESET_MIN_SEGMENTS 2     /* 早判至少观察一响一停 */
+#define RINGBACK_HARMONIC_TOL_HZ      25.0  /* 谐波落在该范围内的频点用于谐波校验 */
+
+/* 频率校验默认值 */
+#define RINGBACK_DEFAULT_MIN_PURITY      0.6
+#define RINGBACK_DEFAULT_MAX_TWIST_DB    10.0
+#define RINGBACK_DEFAULT_MAX_HARMONIC_DB -10.0
+
+/* 能量门限默认值 */
+#define RINGBACK_DEFAULT_SNR_DB          10.0   /* 起音需高于噪声基底 */
+#define RINGBACK_DEFAULT_HYSTERESIS_DB   4.0    /* 收音门限比起音门限低 */
+#define RINGBACK_DEFAULT_MIN_GAP_MS      40     /* 短于此的状态翻转视为抖动 */
+#define RINGBACK_NOISE_WINDOW_MS         3000   /* 长于最长响段，窗口内必有停段 */
+
+typedef struct ringback_toneset {
+    double freqs[RINGBACK_BANK_MAX_BINS];   /* 滤波器组频点，频率特征按下标引用 */
+    int nbins;
+
+    int nsig;
+    uint32_t sig_bins[RINGBACK_TONESET_MAX_SIGS];   /* 频点位图，0 表示只看能量 */
+    uint64_t sig_rules[RINGBACK_TONESET_MAX_SIGS];  /* 使用该频率特征的规则 */
+    uint32_t sig_harm[RINGBACK_TONESET_MAX_SIGS];   /* 落在 2/3 次谐波上的频点位图 */
+
+    int nprofiles;
+    char profile_name[RINGBACK_TONESET_MAX_PROFILES][RINGBACK_PROFILE_NAME_LEN];
+    uint64_t profile_rules[RINGBACK_TONESET_MAX_PROFILES];
+
+    int nrules;
+    ringback_cadence_rule_t rules[RINGBACK_CADENCE_MAX_RULES];
+    int rule_sig[RINGBACK_CADENCE_MAX_RULES];
+    int rule_profile[RINGBACK_CADENCE_MAX_RULES];
+
+    ringback_cadence_t cadence;
+
+    double confidence;      /* 早判后验概率阈值 (0,1)，0 关闭，只按自动机完整匹配 */
+
+    /* 频率校验参数，compile 时换算为功率比 */
+    double min_purity;      /* 特征频点能量占块能量的最小比例，0 关闭 */
+    double max_twist_db;    /* 双频两分量最大功率差 */
+    double max_harmonic_db; /* 谐波相对基波的最大电平 */
+    double twist_ratio;
+    double harmonic_ratio;
+
+    /* 能量门限参数，compile 时换算为功率比 */
+    double snr_db;          /* 起音门限相对噪声基底，0 关闭 (只用绝对门限) */
+    double hysteresis_db;   /* 收音门限 = 起音门限 - hysteresis_db (绝对和相对门限都适用) */
+    uint32_t min_gap_ms;    /* 响/停状态须持续该时长才确认翻转，0 立即翻转 */
+    double snr_ratio;
+    double hysteresis_ratio;
+} ringback_toneset_t;
+
+/* 初始化空方案集合，置信度早判默认关闭，频率校验和能量门限取默认值 */
+void ringback_toneset_init(ringback_toneset_t *ts, const double *freqs, int nbins);
+
+/*
+ * 向方案 profile 追加一条规则，freqs 为 NULL/nfreqs 为 0 时只按能量判断有音。
+ * 频点必须在滤波器组中。返回规则下标，规则/方案/频率特征已满或频点不存在返回 -1
+ */
+int ringback_toneset_add_rule(ringback_toneset_t *ts, const char *profile, const ringback_cadence_rule_t *rule,
+                              const double *freqs, int nfreqs);
+
+/* 追加一个内置国家方案 (方案名为国家代码，规则名为 "代码.信号")，返回加入的规则数，失败返回 -1 */
+int ringback_toneset_add_country(ringback_toneset_t *ts, const ringback_country_t *country);
+
+/* 编译时序自动机并换算频率校验参数，成功返回 0 */
+int ringback_toneset_compile(ringback_toneset_t *ts);
+
+/* 方案名列表 ("cn,uk" / "all") 转为规则位图，未知名称忽略 */
+uint64_t ringback_toneset_select(const ringback_toneset_t *ts, const char *list);
+
+/*
+ * 每路通道的跟踪状态
+ */
+
+/* 单个频率特征的响/停切分状态 */
+typedef struct ringback_sigtrack {
+    int in_tone;
+    uint32_t tone_start_ms;
+    uint32_t silence_start_ms;
+    uint32_t edge_ms;       /* 与 in_tone 相反的状态开始的时刻，0 表示无待确认翻转 */
+    uint32_t nblk;          /* 当前响段的块数及电平、纯度累计 */
+    float rms_sum;
+    float rms_sq;
+    float purity_sum;
+} ringback_sigtrack_t;
+
+typedef struct ringback_tonetrack {
+    ringback_sigtrack_t sig[RINGBACK_TONESET_MAX_SIGS];
+    ringback_cadence_state_t cadence;
+    int noise_valid;        /* 已有噪声基底估计 */
+    double noise_floor;     /* 非有音块均方值的 EWMA */
+    double noise_min;       /* 当前窗口内最安静块的均方值 */
+    uint32_t noise_blocks;
+    uint32_t noise_window_ms;
+    /* 上一块的包络，边沿可能落在上一块内 */
+    int prev_env_n;
+    uint64_t prev_end_us;
+    uint32_t prev_dur_us;
+    float prev_env[RINGBACK_ENV_SLOTS];
+    float odds[RINGBACK_CADENCE_MAX_RULES];     /* 各规则对"不是该信号"的似然比 */
+    uint8_t segs[RINGBACK_CADENCE_MAX_RULES];   /* 连续符合规则的段数 */
+    uint64_t fired;                             /* 本轮已早判的规则，失配后清除 */
+    float confidence;       /* 最近一次判定的置信度，自动机完整匹配为 1 */
+} ringback_tonetrack_t;
+
+void ringback_tonetrack_reset(ringback_tonetrack_t *tr);
+
+/*
+ * 处理一个分析块 (now_ms 为块结束时刻)：能量门限和最强频点只算一次，
+ * 各频率特征分别判断有音并切分响/停段，段结束时推进 rules 中属于该特征的规则。
+ * threshold 为绝对 RMS 下限；起音还需高于噪声基底 snr_db，已在响段中时两者都降低 hysteresis_db。
+ * 状态翻转持续 min_gap_ms 后才确认，段边界取翻转开始的时刻；块带包络时
+ * 在本块和上一块的子块中找能量越过半幅 (-6dB) 的位置作为边沿。
+ * 有音判定：能量超过门限，且 (只看能量的特征除外) 特征最强频点不低于全部频点
+ * 最强者的 1/4 (-6dB)、纯度不低于 min_purity、双频扭曲不超过 max_twist_db、
+ * 谐波频点不超过 max_harmonic_db。
+ * 返回本块完成匹配的规则下标 (多个时取优先级最高者)，无匹配返回 -1。
+ * ts->confidence 非 0 时，未完整匹配但同类信号后验概率达到阈值的规则也会返回
+ * (每轮连续匹配只返回一次)，tr->confidence 为该判定的置信度
+ */
+int ringback_tonetrack_block(const ringback_toneset_t *ts, ringback_tonetrack_t *tr, uint64_t rules,
+                             const ringback_block_t *blk, int threshold, uint32_t now_ms);
+
+/*
+ * 判定后的低开销监视
+ *
+ * 非 stoptone 信号 (通常是回铃音) 判定后不必每帧跑完整分析：记下判定时响段电平、
+ * 噪声基底和规则中最长的响/停时长，之后每隔若干帧只算一帧的分段整数平方和。
+ * 电平落在响段 ±6dB 内且各段平稳算"响"，不高于停段电平算"停"，其余 (语音、
+ * 提示音、边沿) 记一次异常；连续两次异常、或响/停持续超过规则最长时长 (静音、
+ * 连续提示音) 即回到完整分析。
+ */
+#define RINGBACK_MONITOR_SEGS     4     /* 一帧分几段算平方和，段间起伏大视为不平稳 */
+#define RINGBACK_MONITOR_SLACK_MS 500   /* 响/停超过规则最长时长的余量 */
+
+typedef struct ringback_monitor {
+    int active;
+    double on_level;        /* 判定时响段的均方值 */
+    double off_level;       /* 不高于此视为停 */
+    uint32_t max_on_ms;
+    uint32_t max_off_ms;
+    int in_tone;
+    uint32_t since_ms;      /* 当前响/停开始的时刻 */
+    int anomalies;          /* 连续异常次数 */
+} ringback_monitor_t;
+
+/* 规则 r 判定后进入监视，响段电平未知 (没有有音块) 时返回 -1 不进入 */
+int ringback_monitor_start(ringback_monitor_t *m, const ringback_toneset_t *ts, const ringback_tonetrack_t *tr,
+                           int r, uint32_t now_ms);
+
+/*
+ * 检查一帧：seg 为 RINGBACK_MONITOR_SEGS 段等长样本的平方和，count 为总样本数。
+ * 需要回到完整分析时退出监视并返回 1
+ */
+int ringback_monitor_check(ringback_monitor_t *m, const uint64_t *seg, int count, uint32_t now_ms);
+
+#endif /* RINGBACK_TONES_H */
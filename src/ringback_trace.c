@@ -0,0 +1,154 @@
+/*
+ * ringback_trace - 每通道判定跟踪环形缓冲实现
+ */
+
+#include "ringback_trace.h"
+
+#include <stdio.h>
+#include <string.h>
+
+/* 10*log10(2)/256 */
+#define DB_PER_Q8 (3.0102999566398120 / 256.0)
+
+void ringback_trace_init(ringback_trace_t *t, ringback_trace_rec_t *rec, uint32_t size)
+{
+    t->rec = rec;
+    t->size = size;
+    t->head = 0;
+}
+
+double ringback_trace_db(uint32_t q8)
+{
+    return q8 * DB_PER_Q8;
+}
+
+/*
+ * 取下一个槽位。屏障保证上一条记录发布 (head 前移) 先于本槽位的写入可见，
+ * 读者据此判断哪些槽位可能正在被覆盖
+ */
+static ringback_trace_rec_t *trace_next(ringback_trace_t *t)
+{
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    return &t->rec[t->head % t->size];
+}
+
+static void trace_publish(ringback_trace_t *t)
+{
+    __atomic_store_n(&t->head, t->head + 1, __ATOMIC_RELEASE);
+}
+
+void ringback_trace_block(ringback_trace_t *t, uint32_t ms, uint64_t sumsq, int count, const int64_t *power,
+                          int nbins, uint16_t in_tone)
+{
+    ringback_trace_rec_t *r;
+    int i;
+
+    if (!t->size) {
+        return;
+    }
+    r = trace_next(t);
+    r->ms = ms;
+    r->type = RINGBACK_TRACE_BLOCK;
+    r->idx = (uint8_t)nbins;
+    r->flags = in_tone;
+    r->value = ringback_trace_log2(count > 0 ? sumsq / (uint64_t)count : 0);
+    for (i = 0; i < RINGBACK_TRACE_BINS; i++) {
+        r->power[i] = i < nbins && power[i] > 0 ? ringback_trace_log2((uint64_t)power[i]) : 0;
+    }
+    trace_publish(t);
+}
+
+static void trace_event(ringback_trace_t *t, uint32_t ms, int type, int idx, int flags, uint32_t value)
+{
+    ringback_trace_rec_t *r;
+
+    if (!t->size) {
+        return;
+    }
+    r = trace_next(t);
+    r->ms = ms;
+    r->type = (uint8_t)type;
+    r->idx = (uint8_t)idx;
+    r->flags = (uint16_t)flags;
+    r->value = value;
+    trace_publish(t);
+}
+
+void ringback_trace_edge(ringback_trace_t *t, uint32_t ms, int sig, int on, uint32_t seg_ms)
+{
+    trace_event(t, ms, RINGBACK_TRACE_EDGE, sig, on != 0, seg_ms);
+}
+
+void ringback_trace_rule(ringback_trace_t *t, uint32_t ms, int rule, int tone, float confidence)
+{
+    trace_event(t, ms, RINGBACK_TRACE_RULE, rule, tone, (uint32_t)(confidence * 1000.0f + 0.5f));
+}
+
+void ringback_trace_monitor(ringback_trace_t *t, uint32_t ms, int enter)
+{
+    trace_event(t, ms, RINGBACK_TRACE_MONITOR, 0, enter != 0, 0);
+}
+
+/*
+ * 先复制 [h1 - size, h1)，再读一次 head (h2)：写者可能正在写第 h2 条，
+ * 即覆盖第 h2 - size 条，所以只保留序号不小于 h2 - size + 1 的记录
+ */
+int ringback_trace_snapshot(const ringback_trace_t *t, ringback_trace_rec_t *out, int max)
+{
+    uint32_t h1, h2, first, keep, i;
+    int n = 0;
+
+    if (!t->size || max <= 0) {
+        return 0;
+    }
+    h1 = __atomic_load_n(&t->head, __ATOMIC_ACQUIRE);
+    first = h1 > t->size ? h1 - t->size : 0;
+    if (h1 - first > (uint32_t)max) {
+        first = h1 - (uint32_t)max;
+    }
+    for (i = first; i < h1; i++) {
+        out[n++] = t->rec[i % t->size];
+    }
+
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    h2 = __atomic_load_n(&t->head, __ATOMIC_RELAXED);
+    keep = h2 >= t->size ? h2 - t->size + 1 : 0;
+    if (keep > first) {
+        uint32_t drop = keep - first > (uint32_t)n ? (uint32_t)n : keep - first;
+        memmove(out, out + drop, (n - drop) * sizeof(*out));
+        n -= (int)drop;
+    }
+    return n;
+}
+
+int ringback_trace_format(const ringback_trace_rec_t *r, const double *freqs, int nbins,
+                          const ringback_toneset_t *tones, char *buf, size_t len)
+{
+    int n, i;
+
+    switch (r->type) {
+    case RINGBACK_TRACE_BLOCK:
+        n = snprintf(buf, len, "%7u ms block   energy %5.1f dB  on 0x%03x ", r->ms, ringback_trace_db(r->value),
+                     r->flags);
+        if (nbins > r->idx) {
+            nbins = r->idx;
+        }
+        for (i = 0; i < nbins && n >= 0 && (size_t)n < len; i++) {
+            n += snprintf(buf + n, len - n, " %.0f:%.1f", freqs[i], ringback_trace_db(r->power[i]));
+        }
+        return n;
+    case RINGBACK_TRACE_EDGE:
+        return snprintf(buf, len, "%7u ms edge    sig %u %s, previous segment %u ms", r->ms, r->idx,
+                        r->flags ? "on" : "off", r->value);
+    case RINGBACK_TRACE_RULE:
+        if (tones && r->idx < tones->nrules) {
+            return snprintf(buf, len, "%7u ms rule    %s (tone 0x%02x) confidence %.3f", r->ms,
+                            tones->rules[r->idx].name, r->flags, r->value / 1000.0);
+        }
+        return snprintf(buf, len, "%7u ms rule    #%u (tone 0x%02x) confidence %.3f", r->ms, r->idx, r->flags,
+                        r->value / 1000.0);
+    case RINGBACK_TRACE_MONITOR:
+        return snprintf(buf, len, "%7u ms monitor %s", r->ms, r->flags ? "enter" : "resume full analysis");
+    }
+    return snprintf(buf, len, "%7u ms type %u", r->ms, r->type);
+}
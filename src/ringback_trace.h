@@ -0,0 +1,82 @@
+/*
+ * ringback_trace - 每通道判定跟踪环形缓冲
+ *
+ * 保存最近 N 个定长二进制记录：每个分析块的能量、各频点功率和各频率特征的有音状态，
+ * 响停边沿 (含刚结束的段时长)、规则命中和监视模式进出。写入只填一个预分配的槽位，
+ * 功率按 log2 定点量化 (整数运算)，不分配内存、不格式化。误判时按需解码成文本，
+ * 还原判定过程。
+ *
+ * 单写者 (分析线程)；读者用 ringback_trace_snapshot 无锁复制，
+ * 复制期间被覆盖的记录会被丢弃，不会读到写了一半的记录。
+ *
+ * 不依赖 FreeSWITCH，可单独编译测试。
+ */
+
+#ifndef RINGBACK_TRACE_H
+#define RINGBACK_TRACE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "ringback_dsp.h"
+#include "ringback_tones.h"
+
+#define RINGBACK_TRACE_BINS RINGBACK_BANK_MAX_BINS
+
+enum {
+    RINGBACK_TRACE_BLOCK,       /* 分析块 */
+    RINGBACK_TRACE_EDGE,        /* 频率特征响/停翻转 */
+    RINGBACK_TRACE_RULE,        /* 时序规则命中 */
+    RINGBACK_TRACE_MONITOR      /* 进入/退出监视模式 */
+};
+
+typedef struct ringback_trace_rec {
+    uint32_t ms;                /* 块结束或边沿时刻 (检测开始起) */
+    uint8_t type;               /* RINGBACK_TRACE_* */
+    uint8_t idx;                /* EDGE: 特征下标；RULE: 规则下标 */
+    uint16_t flags;             /* BLOCK: 各特征有音位图；EDGE/MONITOR: 1 起音/进入；RULE: 信号类型 */
+    uint32_t value;             /* BLOCK: 块均方值 (log2 Q8)；EDGE: 刚结束的段时长 ms；RULE: 置信度 x1000 */
+    uint16_t power[RINGBACK_TRACE_BINS];    /* BLOCK: 各频点功率 (log2 Q8) */
+} ringback_trace_rec_t;
+
+typedef struct ringback_trace {
+    ringback_trace_rec_t *rec;
+    uint32_t size;              /* 槽位数 */
+    volatile uint32_t head;     /* 已写入的记录总数，槽位 head % size 为下一个 */
+} ringback_trace_t;
+
+/* rec 为调用方提供的 size 个槽位 */
+void ringback_trace_init(ringback_trace_t *t, ringback_trace_rec_t *rec, uint32_t size);
+
+/* log2(v) 的 Q8 定点值，v 为 0 时返回 0 */
+static inline uint16_t ringback_trace_log2(uint64_t v)
+{
+    int e;
+
+    if (!v) {
+        return 0;
+    }
+    e = 63 - __builtin_clzll(v);
+    return (uint16_t)((e << 8) | (uint32_t)((e >= 8 ? v >> (e - 8) : v << (8 - e)) & 0xff));
+}
+
+/* Q8 log2 值换算为 dB (10*log10) */
+double ringback_trace_db(uint32_t q8);
+
+void ringback_trace_block(ringback_trace_t *t, uint32_t ms, uint64_t sumsq, int count, const int64_t *power,
+                          int nbins, uint16_t in_tone);
+void ringback_trace_edge(ringback_trace_t *t, uint32_t ms, int sig, int on, uint32_t seg_ms);
+void ringback_trace_rule(ringback_trace_t *t, uint32_t ms, int rule, int tone, float confidence);
+void ringback_trace_monitor(ringback_trace_t *t, uint32_t ms, int enter);
+
+/* 按时间顺序复制最多 max 条仍有效的记录，返回条数 */
+int ringback_trace_snapshot(const ringback_trace_t *t, ringback_trace_rec_t *out, int max);
+
+/*
+ * 把一条记录解码为一行文本 (不含换行)，freqs 为各频点频率，
+ * tones 非 NULL 时按规则下标给出规则名。返回 snprintf 语义的长度
+ */
+int ringback_trace_format(const ringback_trace_rec_t *r, const double *freqs, int nbins,
+                          const ringback_toneset_t *tones, char *buf, size_t len);
+
+#endif /* RINGBACK_TRACE_H */
@@ -7,24 +7,25 @@
 #include <stdint.h>
 #include <math.h>
 #include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
 
-#define SAMPLE_RATE 8000
+#include "ringback_dsp.h"
+#include "ringback_cadence.h"
+#include "ringback_tones.h"
+#include "ringback_prefix.h"
+#include "ringback_timer.h"
+#include "ringback_ring.h"
+#include "ringback_stats.h"
+#include "ringback_trace.h"
+#include "ringback_detector.h"
+
+#define SAMPLE_RATE RINGBACK_DETECTOR_RATE
 #define TARGET_FREQ 450.0
-#define GOERTZEL_N 205
-
-/* 时序规则 (与 mod_ringback.c 一致) */
-#define BUSY_ON_MIN      250
-#define BUSY_ON_MAX      450
-#define BUSY_OFF_MIN     250
-#define BUSY_OFF_MAX     450
-#define RINGBACK_ON_MIN  900
-#define RINGBACK_ON_MAX  1200
-#define RINGBACK_OFF_MIN 3000
-#define RINGBACK_OFF_MAX 5000
-#define CONGESTION_ON_MIN  600
-#define CONGESTION_ON_MAX  800
-#define CONGESTION_OFF_MIN 500
-#define CONGESTION_OFF_MAX 900
+#define GOERTZEL_N RINGBACK_DETECTOR_BLOCK
+
+/* 各节的测试门限，比缺省值 RINGBACK_DEFAULT_ENERGY 高，白噪声用例据此设幅度 */
 #define ENERGY_THRESHOLD 500
 
 static int tests_run = 0;
@@ -36,24 +37,32 @@ static int tests_failed = 0;
     else { printf("OK: %s\n", msg); } \
 } while(0)
 
-static int match_busy_pattern(uint32_t on_ms, uint32_t off_ms)
+/* 内置缺省规则按模块的顺序和周期数编译：忙音、拥塞音两个周期，回铃音一个周期 */
+static void compile_default_rules(ringback_cadence_t *cad)
 {
-    return (on_ms >= BUSY_ON_MIN && on_ms <= BUSY_ON_MAX &&
-            off_ms >= BUSY_OFF_MIN && off_ms <= BUSY_OFF_MAX);
-}
+    ringback_cadence_rule_t rules[3];
 
-static int match_ringback_pattern(uint32_t on_ms, uint32_t off_ms)
-{
-    return (on_ms >= RINGBACK_ON_MIN && on_ms <= RINGBACK_ON_MAX &&
-            off_ms >= RINGBACK_OFF_MIN && off_ms <= RINGBACK_OFF_MAX);
+    ringback_cadence_parse(&rules[0], "busy", RINGBACK_TONE_BUSY, RINGBACK_DEFAULT_BUSY_RULE, 2);
+    ringback_cadence_parse(&rules[1], "congestion", RINGBACK_TONE_CONGESTION, RINGBACK_DEFAULT_CONGESTION_RULE, 2);
+    ringback_cadence_parse(&rules[2], "ringback", RINGBACK_TONE_RINGBACK, RINGBACK_DEFAULT_RINGBACK_RULE, 1);
+    ringback_cadence_compile(cad, rules, 3);
 }
 
-static int match_congestion_pattern(uint32_t on_ms, uint32_t off_ms)
+/* 响|停 序列重复两个周期，返回命中规则的信号类型，无命中返回 0 */
+static int match_default_rule(const ringback_cadence_t *cad, uint32_t on_ms, uint32_t off_ms)
 {
-    return (on_ms >= CONGESTION_ON_MIN && on_ms <= CONGESTION_ON_MAX &&
-            off_ms >= CONGESTION_OFF_MIN && off_ms <= CONGESTION_OFF_MAX);
+    ringback_cadence_state_t st;
+    int m = -1;
+
+    ringback_cadence_reset(&st);
+    for (int i = 0; i < 2 && m < 0; i++) {
+        m = ringback_cadence_step(cad, &st, 1, on_ms);
+        m = m < 0 ? ringback_cadence_step(cad, &st, 0, off_ms) : m;
+    }
+    return m >= 0 ? cad->rules[m].tone : 0;
 }
 
+/* double 参考实现的 RMS */
 static double calc_frame_energy(int16_t *samples, int count)
 {
     double sum = 0;
@@ -78,40 +87,1357 @@ static void generate_silence(int16_t *buf, int samples)
     memset(buf, 0, samples * sizeof(int16_t));
 }
 
+/*
+ * 按 响|停 时长序列 (ms) 合成单频/双频信号音，经滤波器组分块后送入多方案跟踪，
+ * 返回首个命中的规则下标，无命中返回 -1。命中时刻和置信度记入 cadence_verdict_ms/cadence_confidence。
+ * amp 为每个频率分量的幅度，noise 为叠加的均匀白噪声幅度 (响停段都有)，
+ * dropout_ms 为每个响段中间插入的掉音时长，threshold 为绝对能量门限
+ */
+static uint32_t cadence_verdict_ms;
+static float cadence_confidence;
+static ringback_tonetrack_t cadence_track;
+
+static int run_cadence_ex(const ringback_toneset_t *ts, uint64_t rules, double f1, double f2,
+                          const int *seg_ms, int nseg, int repeat, int amp, int noise, int dropout_ms,
+                          int threshold)
+{
+    ringback_bank_t bank;
+    ringback_stream_t st;
+    ringback_block_t blocks[RINGBACK_STREAM_MAX_BLOCKS];
+    int16_t frame[160];
+    long n = 0;
+
+    ringback_bank_init(&bank, ts->freqs, ts->nbins, SAMPLE_RATE);
+    ringback_stream_init(&st, &bank, GOERTZEL_N);
+    ringback_tonetrack_reset(&cadence_track);
+
+    for (int k = 0; k < repeat; k++) {
+        for (int sgi = 0; sgi < nseg; sgi++) {
+            int len = seg_ms[sgi] * SAMPLE_RATE / 1000;
+            for (int i = 0; i < len; i += 160) {
+                int cnt = len - i < 160 ? len - i : 160;
+                for (int j = 0; j < cnt; j++, n++) {
+                    double t = (double)n / SAMPLE_RATE;
+                    int pos = (i + j) * 1000 / SAMPLE_RATE;
+                    int drop = pos >= seg_ms[sgi] / 2 && pos < seg_ms[sgi] / 2 + dropout_ms;
+                    double v = (sgi & 1) || drop ? 0 : amp * sin(2 * M_PI * f1 * t) +
+                                                       (f2 > 0 ? amp * sin(2 * M_PI * f2 * t) : 0);
+                    if (noise > 0) {
+                        v += rand() % (2 * noise + 1) - noise;
+                    }
+                    frame[j] = (int16_t)v;
+                }
+                int nb = ringback_stream_feed(&st, frame, cnt, blocks, RINGBACK_STREAM_MAX_BLOCKS);
+                for (int b = 0; b < nb; b++) {
+                    int r = ringback_tonetrack_block(ts, &cadence_track, rules, &blocks[b], threshold,
+                                                     (uint32_t)(blocks[b].end_sample * 1000 / SAMPLE_RATE));
+                    if (r >= 0) {
+                        cadence_verdict_ms = (uint32_t)(blocks[b].end_sample * 1000 / SAMPLE_RATE);
+                        cadence_confidence = cadence_track.confidence;
+                        return r;
+                    }
+                }
+            }
+        }
+    }
+    return -1;
+}
+
+static int run_cadence(const ringback_toneset_t *ts, uint64_t rules, double f1, double f2,
+                       const int *seg_ms, int nseg, int repeat)
+{
+    return run_cadence_ex(ts, rules, f1, f2, seg_ms, nseg, repeat, 4000, 0, 0, ENERGY_THRESHOLD);
+}
+
+/* 同一 20ms 块连续出现 (超过 min_gap_ms 确认翻转) 时，频点位图为 bins 的频率特征是否判为有音 */
+static int sig_on(const ringback_toneset_t *ts, uint32_t bins, const int16_t *samples)
+{
+    static ringback_tonetrack_t tr;
+    ringback_bank_t bank;
+    ringback_block_t blk;
+    int s;
+
+    ringback_bank_init(&bank, ts->freqs, ts->nbins, SAMPLE_RATE);
+    memset(&blk, 0, sizeof(blk));
+    blk.sumsq = ringback_bank_process(&bank, samples, GOERTZEL_N);
+    blk.count = GOERTZEL_N;
+    ringback_bank_powers(&bank, blk.power);
+    ringback_tonetrack_reset(&tr);
+    for (uint32_t ms = 20; ms <= 20 + ts->min_gap_ms; ms += 20) {
+        ringback_tonetrack_block(ts, &tr, ~UINT64_C(0), &blk, ENERGY_THRESHOLD, ms);
+    }
+
+    for (s = 0; s < ts->nsig; s++) {
+        if (ts->sig_bins[s] == bins) {
+            return tr.sig[s].in_tone;
+        }
+    }
+    return -1;
+}
+
+/*
+ * 监视模式下送入 ms 毫秒的信号 (20ms 一帧，每 5 帧检查一次)：
+ * voice 为 0 时是幅度 amp 的 450Hz 单音，否则为电平逐段起伏的类语音信号。
+ * 回到完整分析时返回该时刻，否则返回 0；*t_ms 为样本时钟
+ */
+static uint32_t run_monitor(ringback_monitor_t *m, uint32_t *t_ms, int ms, int amp, int voice)
+{
+    static const double gain[] = { 1.0, 0.1, 1.6, 0.3, 0.05, 1.2, 0.5, 2.0 };
+    int16_t frame[160];
+    uint64_t seg[RINGBACK_MONITOR_SEGS];
+    int f, j, k;
+
+    for (f = 0; f < ms / 20; f++) {
+        *t_ms += 20;
+        if ((*t_ms / 20) % 5) {
+            continue;
+        }
+        for (j = 0; j < 160; j++) {
+            double t = (double)(*t_ms * 8 + j) / SAMPLE_RATE;
+            double g = voice ? gain[(f + j / 40) % 8] : 1.0;
+            frame[j] = (int16_t)(amp * g * sin(2 * M_PI * (voice ? 210 : 450) * t));
+        }
+        for (k = 0; k < RINGBACK_MONITOR_SEGS; k++) {
+            seg[k] = ringback_energy_sumsq(frame + k * 40, 40);
+        }
+        if (ringback_monitor_check(m, seg, 160, *t_ms)) {
+            return *t_ms;
+        }
+    }
+    return 0;
+}
+
+/*
+ * 检测器端到端：按 响|停 时长序列 (ms) 合成 450Hz 信号音，以 20ms 帧送入检测器，
+ * law 非 NONE 时帧载荷为 G.711 编码 (按解码表取最近码字)。帧带递增的 RTP 序号和时间戳。
+ * 返回首个非 CONTINUE 的 feed 结果并取出判定，整段无判定返回 CONTINUE
+ */
+static int null_block_calls;
+
+static int null_block_fn(void *arg, const int16_t *samples, int count, ringback_block_t *out)
+{
+    (void)arg;
+    (void)samples;
+    (void)count;
+    (void)out;
+    null_block_calls++;
+    return 0;
+}
+
+static int run_detector(ringback_detector_t *d, const ringback_toneset_t *ts, int rate, int law,
+                        const int *seg_ms, int nseg, int repeat, ringback_verdict_t *v)
+{
+    int16_t pcm[RINGBACK_BATCH_MAX_SAMPLES * 6];
+    uint8_t g711[RINGBACK_BATCH_MAX_SAMPLES];
+    const int16_t *table = law == RINGBACK_G711_ALAW ? ringback_alaw_table : ringback_ulaw_table;
+    int spf = rate / 50, n = 0;
+    ringback_detector_frame_t f;
+
+    memset(&f, 0, sizeof(f));
+    for (int k = 0; k < repeat; k++) {
+        for (int sgi = 0; sgi < nseg; sgi++) {
+            for (int i = 0; i < seg_ms[sgi] / 20; i++) {
+                for (int j = 0; j < spf; j++, n++) {
+                    pcm[j] = (sgi & 1) ? 0 : (int16_t)(4000 * sin(2 * M_PI * TARGET_FREQ * n / rate));
+                }
+                if (law != RINGBACK_G711_NONE) {
+                    for (int j = 0; j < spf; j++) {
+                        int best = 0;
+                        for (int c = 1; c < 256; c++) {
+                            if (abs(table[c] - pcm[j]) < abs(table[best] - pcm[j])) best = c;
+                        }
+                        g711[j] = (uint8_t)best;
+                    }
+                }
+                f.data = law != RINGBACK_G711_NONE ? (const void *)g711 : (const void *)pcm;
+                f.datalen = law != RINGBACK_G711_NONE ? (uint32_t)spf : (uint32_t)spf * 2;
+                f.samples = (uint32_t)spf;
+                f.rate = (uint32_t)rate;
+                f.seq++;
+                f.timestamp += (uint32_t)spf;
+                int r = ringback_detector_feed(d, ts, &f);
+                if (r != RINGBACK_DETECT_CONTINUE) {
+                    ringback_detector_poll(d, v);
+                    return r;
+                }
+            }
+        }
+    }
+    return RINGBACK_DETECT_CONTINUE;
+}
+
+/* 时间轮测试：到期时记录实际节拍，arg 指向期望节拍 */
+static uint64_t wheel_fired_at[64];
+static int wheel_fired_n;
+static ringback_wheel_t *wheel_under_test;
+
+static void wheel_record(ringback_timer_t *t, void *arg)
+{
+    (void)t;
+    (void)arg;
+    if (wheel_fired_n < 64) {
+        wheel_fired_at[wheel_fired_n] = wheel_under_test->now - 1;
+    }
+    wheel_fired_n++;
+}
+
+/* 到期后自动改期 period 拍 */
+static void wheel_rearm(ringback_timer_t *t, void *arg)
+{
+    wheel_fired_n++;
+    ringback_wheel_add(wheel_under_test, t, t->expires + *(uint64_t *)arg);
+}
+
+/* 环形队列并发测试：生产者写入递增序号，消费者按序取出 */
+#define RING_TEST_FRAMES 100000
+
+static void *ring_producer(void *arg)
+{
+    ringback_ring_t *r = (ringback_ring_t *)arg;
+    uint32_t i;
+
+    for (i = 0; i < RING_TEST_FRAMES;) {
+        if (ringback_ring_push(r, &i, sizeof(i), 1, 8000, i, (uint16_t)i, 0) == 0) {
+            i++;
+        } else {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
 int main(void)
 {
     printf("=== mod_ringback 算法单元测试 ===\n\n");
 
-    /* 1. 忙音模式匹配 */
-    ASSERT(match_busy_pattern(350, 350) == 1, "忙音 350/350 应匹配");
-    ASSERT(match_busy_pattern(300, 300) == 1, "忙音 300/300 应匹配");
-    ASSERT(match_busy_pattern(400, 400) == 1, "忙音 400/400 应匹配");
-    ASSERT(match_busy_pattern(200, 350) == 0, "忙音 200/350 不应匹配(太短)");
-    ASSERT(match_busy_pattern(500, 350) == 0, "忙音 500/350 不应匹配(太长)");
+    /* 1-3. 内置缺省规则 (与模块、ringback.conf.xml 同一组定义) */
+    {
+        static ringback_cadence_t cad;
+        compile_default_rules(&cad);
+
+        /* 1. 忙音模式匹配 */
+        ASSERT(match_default_rule(&cad, 350, 350) == RINGBACK_TONE_BUSY, "忙音 350/350 应匹配");
+        ASSERT(match_default_rule(&cad, 300, 300) == RINGBACK_TONE_BUSY, "忙音 300/300 应匹配");
+        ASSERT(match_default_rule(&cad, 400, 400) == RINGBACK_TONE_BUSY, "忙音 400/400 应匹配");
+        ASSERT(match_default_rule(&cad, 200, 350) == 0, "忙音 200/350 不应匹配(太短)");
+        ASSERT(match_default_rule(&cad, 500, 350) == 0, "忙音 500/350 不应匹配(太长)");
 
-    /* 2. 回铃音模式匹配 */
-    ASSERT(match_ringback_pattern(1000, 4000) == 1, "回铃音 1000/4000 应匹配");
-    ASSERT(match_ringback_pattern(900, 3500) == 1, "回铃音 900/3500 应匹配");
-    ASSERT(match_ringback_pattern(350, 350) == 0, "忙音不应匹配回铃音");
+        /* 2. 回铃音模式匹配 */
+        ASSERT(match_default_rule(&cad, 1000, 4000) == RINGBACK_TONE_RINGBACK, "回铃音 1000/4000 应匹配");
+        ASSERT(match_default_rule(&cad, 900, 3500) == RINGBACK_TONE_RINGBACK, "回铃音 900/3500 应匹配");
+        ASSERT(match_default_rule(&cad, 350, 350) != RINGBACK_TONE_RINGBACK, "忙音不应匹配回铃音");
 
-    /* 3. 拥塞音模式匹配 */
-    ASSERT(match_congestion_pattern(700, 700) == 1, "拥塞音 700/700 应匹配");
-    ASSERT(match_congestion_pattern(650, 600) == 1, "拥塞音 650/600 应匹配");
+        /* 3. 拥塞音模式匹配 */
+        ASSERT(match_default_rule(&cad, 700, 700) == RINGBACK_TONE_CONGESTION, "拥塞音 700/700 应匹配");
+        ASSERT(match_default_rule(&cad, 650, 600) == RINGBACK_TONE_CONGESTION, "拥塞音 650/600 应匹配");
+    }
 
-    /* 4. 能量检测 - 450Hz 信号应有足够能量 */
+    /* 4. 能量检测 - 450Hz 信号应超过缺省门限 */
     {
         int16_t buf[320];  /* 40ms @ 8kHz */
         generate_450hz_tone(buf, 320, 8000);
-        double energy = calc_frame_energy(buf, 320);
-        ASSERT(energy > ENERGY_THRESHOLD, "450Hz 信号能量应超过阈值");
+        ASSERT(ringback_energy_above(ringback_energy_sumsq(buf, 320), 320, RINGBACK_DEFAULT_ENERGY),
+               "450Hz 信号能量应超过阈值");
     }
 
-    /* 5. 能量检测 - 静音应低于阈值 */
+    /* 5. 能量检测 - 静音和 -47dBm0 左右的弱信号应低于缺省门限 */
     {
         int16_t buf[320];
         generate_silence(buf, 320);
-        double energy = calc_frame_energy(buf, 320);
-        ASSERT(energy < ENERGY_THRESHOLD, "静音能量应低于阈值");
+        ASSERT(!ringback_energy_above(ringback_energy_sumsq(buf, 320), 320, RINGBACK_DEFAULT_ENERGY),
+               "静音能量应低于阈值");
+        generate_450hz_tone(buf, 320, 100);
+        ASSERT(!ringback_energy_above(ringback_energy_sumsq(buf, 320), 320, RINGBACK_DEFAULT_ENERGY),
+               "低电平信号能量应低于阈值");
+    }
+
+    /* 6. 定点滤波器组 (生产路径) - 平方和精确，阈值判断与 RMS 一致 */
+    {
+        static const double f450[] = { TARGET_FREQ };
+        int16_t buf[160];
+        ringback_bank_t bank;
+        uint64_t exact = 0;
+        generate_450hz_tone(buf, 160, 8000);
+        for (int i = 0; i < 160; i++) exact += (int64_t)buf[i] * buf[i];
+        ringback_bank_init(&bank, f450, 1, SAMPLE_RATE);
+        uint64_t sumsq = ringback_bank_process(&bank, buf, 160);
+        ASSERT(sumsq == exact, "滤波器组平方和应与精确值一致");
+        ASSERT(ringback_energy_above(sumsq, 160, ENERGY_THRESHOLD) ==
+               (calc_frame_energy(buf, 160) > ENERGY_THRESHOLD), "平方阈值判断应与 RMS 判断一致");
+        generate_silence(buf, 160);
+        sumsq = ringback_energy_sumsq(buf, 160);
+        ASSERT(!ringback_energy_above(sumsq, 160, ENERGY_THRESHOLD), "静音平方和应低于平方阈值");
+    }
+
+    /* 7. 定点滤波器组 (当前内核) 功率应与 double 参考实现一致 (误差 < 1%) */
+    {
+        static const double f450[] = { TARGET_FREQ };
+        int16_t buf[GOERTZEL_N];
+        int64_t power[RINGBACK_BANK_MAX_BINS];
+        ringback_bank_t bank;
+        ringback_goertzel_ref_t ref;
+        generate_450hz_tone(buf, GOERTZEL_N, 8000);
+        ringback_bank_init(&bank, f450, 1, SAMPLE_RATE);
+        ringback_ref_goertzel_init(&ref, TARGET_FREQ, SAMPLE_RATE);
+        ringback_bank_process(&bank, buf, GOERTZEL_N);
+        ringback_bank_powers(&bank, power);
+        ringback_ref_goertzel_process(&ref, buf, GOERTZEL_N);
+        double fixed = (double)power[0];
+        double expect = ringback_ref_goertzel_power(&ref);
+        ASSERT(fabs(fixed - expect) < expect * 0.01, "定点 Goertzel 功率误差应 < 1%");
+
+        /* 非目标频率功率应远低于目标频率 */
+        for (int i = 0; i < GOERTZEL_N; i++) {
+            buf[i] = (int16_t)(8000 * sin(2 * M_PI * 1000.0 * i / SAMPLE_RATE));
+        }
+        ringback_bank_reset(&bank);
+        ringback_bank_process(&bank, buf, GOERTZEL_N);
+        ringback_bank_powers(&bank, power);
+        ASSERT((double)power[0] * 100 < fixed, "1000Hz 信号在 450Hz 频点功率应低 20dB 以上");
+    }
+
+    /* 8. 滤波器组 - 各 SIMD 内核与标量结果逐位一致 */
+    {
+        static const double freqs[] = { 350, 400, 425, 440, 450, 480, 620, 913.8,
+                                        985.2, 1370.6, 1428.5, 1776.7 };
+        int nbins = (int)(sizeof(freqs) / sizeof(freqs[0]));
+        int16_t buf[GOERTZEL_N];
+        int64_t expect[RINGBACK_BANK_MAX_BINS], got[RINGBACK_BANK_MAX_BINS];
+        ringback_bank_t bank;
+        ringback_goertzel_t g;
+        char msg[128];
+
+        /* 440+480 双频 (北美回铃音) */
+        for (int i = 0; i < GOERTZEL_N; i++) {
+            buf[i] = (int16_t)(4000 * sin(2 * M_PI * 440.0 * i / SAMPLE_RATE) +
+                               4000 * sin(2 * M_PI * 480.0 * i / SAMPLE_RATE));
+        }
+
+        ringback_bank_init(&bank, freqs, nbins, SAMPLE_RATE);
+        ringback_kernel_select("scalar");
+        uint64_t expect_sumsq = ringback_bank_process(&bank, buf, GOERTZEL_N);
+        ringback_bank_powers(&bank, expect);
+
+        for (int k = 1; k < ringback_kernel_count(); k++) {
+            const ringback_kernel_t *kernel = ringback_kernel_get(k);
+            if (!kernel->supported()) {
+                printf("SKIP: 内核 %s (CPU 不支持)\n", kernel->name);
+                continue;
+            }
+            ringback_kernel_select(kernel->name);
+            ringback_bank_reset(&bank);
+            /* 分两段处理，验证跨调用状态延续 */
+            uint64_t sumsq = ringback_bank_process(&bank, buf, 100);
+            sumsq += ringback_bank_process(&bank, buf + 100, GOERTZEL_N - 100);
+            ringback_bank_powers(&bank, got);
+            snprintf(msg, sizeof(msg), "内核 %s 与标量结果逐位一致", kernel->name);
+            ASSERT(sumsq == expect_sumsq && !memcmp(got, expect, nbins * sizeof(int64_t)), msg);
+        }
+        ringback_dsp_init();
+
+        ringback_goertzel_init(&g, 450.0, SAMPLE_RATE);
+        ringback_fused_process(&g, buf, GOERTZEL_N);
+        ASSERT(expect[ringback_bank_find(&bank, 450.0)] == ringback_goertzel_power(&g),
+               "滤波器组 450Hz 频点应与单频点参考内核一致");
+
+        int i440 = ringback_bank_find(&bank, 440.0), i480 = ringback_bank_find(&bank, 480.0);
+        int i620 = ringback_bank_find(&bank, 620.0), i1400 = ringback_bank_find(&bank, 1428.5);
+        ASSERT(expect[i440] > expect[i620] * 10 && expect[i480] > expect[i620] * 10,
+               "440+480 双频应在 440/480 频点显著高于 620 频点");
+        ASSERT(expect[i480] > expect[i1400] * 1000, "440+480 双频在 SIT 频点应无能量");
+        ASSERT(ringback_bank_init(&bank, freqs, RINGBACK_BANK_MAX_BINS + 1, SAMPLE_RATE) == -1,
+               "超过频点上限应返回错误");
+    }
+
+    /* 9. 流式分块 - 30ms 帧跨 20ms 块续接，无样本丢弃，块结果与连续计算一致 */
+    {
+        static const double freqs[] = { 440, 450, 480 };
+        enum { FRAME = 240, NFRAMES = 4 };
+        int16_t buf[FRAME * NFRAMES];
+        ringback_bank_t bank;
+        ringback_stream_t st;
+        ringback_block_t blocks[RINGBACK_STREAM_MAX_BLOCKS * NFRAMES];
+        int nblocks = 0, ok = 1;
+
+        generate_450hz_tone(buf, FRAME * NFRAMES, 8000);
+        ringback_bank_init(&bank, freqs, 3, SAMPLE_RATE);
+        ringback_stream_init(&st, &bank, GOERTZEL_N);
+        for (int f = 0; f < NFRAMES; f++) {
+            nblocks += ringback_stream_feed(&st, buf + f * FRAME, FRAME, blocks + nblocks,
+                                            RINGBACK_STREAM_MAX_BLOCKS);
+        }
+        ASSERT(nblocks == FRAME * NFRAMES / GOERTZEL_N && st.samples == FRAME * NFRAMES && st.dropped == 0,
+               "4 个 30ms 帧应恰好产生 6 个 20ms 块");
+
+        for (int b = 0; b < nblocks; b++) {
+            int64_t powers[RINGBACK_BANK_MAX_BINS];
+            const int16_t *x = buf + b * GOERTZEL_N;
+            ringback_bank_reset(&bank);
+            uint64_t sumsq = ringback_bank_process(&bank, x, GOERTZEL_N);
+            ringback_bank_powers(&bank, powers);
+            if (blocks[b].sumsq != sumsq || blocks[b].count != GOERTZEL_N ||
+                blocks[b].end_sample != (uint64_t)(b + 1) * GOERTZEL_N ||
+                memcmp(blocks[b].power, powers, 3 * sizeof(int64_t))) {
+                ok = 0;
+            }
+        }
+        ASSERT(ok, "跨帧块结果应与连续样本计算逐位一致");
+
+        /* 10ms 帧：两帧一块，第一帧不出块 */
+        ringback_stream_init(&st, &bank, GOERTZEL_N);
+        ASSERT(ringback_stream_feed(&st, buf, 80, blocks, RINGBACK_STREAM_MAX_BLOCKS) == 0 &&
+               ringback_stream_feed(&st, buf + 80, 80, blocks, RINGBACK_STREAM_MAX_BLOCKS) == 1,
+               "10ms 帧应每两帧完成一块");
+
+        /* 丢包空缺：半块被丢弃，样本时钟前移，下一块按真实时间结束 */
+        ringback_stream_init(&st, &bank, GOERTZEL_N);
+        ringback_stream_feed(&st, buf, 80, blocks, RINGBACK_STREAM_MAX_BLOCKS);
+        ringback_stream_skip(&st, 160);
+        ASSERT(ringback_stream_feed(&st, buf, GOERTZEL_N, blocks, RINGBACK_STREAM_MAX_BLOCKS) == 1 &&
+               blocks[0].count == GOERTZEL_N && blocks[0].end_sample == 80 + 160 + GOERTZEL_N,
+               "跳过空缺后块应从头累计，结束位置计入空缺");
+    }
+
+    /* 10. G.711 原生分析 - 查表值符合 G.711，SIMD 解码与查表一致，结果与线性输入一致 */
+    {
+        uint8_t all[256 + 7];
+        int16_t expect[256 + 7], got[256 + 7];
+        char msg[128];
+
+        ringback_dsp_init();
+        ASSERT(ringback_ulaw_table[0xFF] == 0 && ringback_ulaw_table[0x00] == -32124 &&
+               ringback_ulaw_table[0x80] == 32124 && ringback_ulaw_table[0x7F] == 0,
+               "µ-law 解码表端点值");
+        ASSERT(ringback_alaw_table[0xD5] == 8 && ringback_alaw_table[0x55] == -8 &&
+               ringback_alaw_table[0xAA] == 32256 && ringback_alaw_table[0x2A] == -32256,
+               "A-law 解码表端点值");
+        ASSERT(ringback_g711_law("PCMU") == RINGBACK_G711_ULAW && ringback_g711_law("pcma") == RINGBACK_G711_ALAW &&
+               ringback_g711_law("L16") == RINGBACK_G711_NONE, "按 iananame 识别 G.711");
+
+        /* 263 字节：覆盖全部码字并留出非 16 整数倍的尾部 */
+        for (int i = 0; i < 256 + 7; i++) all[i] = (uint8_t)(i * 37);
+        for (int law = RINGBACK_G711_ULAW; law <= RINGBACK_G711_ALAW; law++) {
+            const int16_t *table = law == RINGBACK_G711_ULAW ? ringback_ulaw_table : ringback_alaw_table;
+            for (int i = 0; i < 256 + 7; i++) expect[i] = table[all[i]];
+            for (int k = 0; k < ringback_kernel_count(); k++) {
+                const ringback_kernel_t *kernel = ringback_kernel_get(k);
+                if (!kernel->supported()) continue;
+                memset(got, 0, sizeof(got));
+                kernel->g711(all, got, 256 + 7, law);
+                snprintf(msg, sizeof(msg), "%s 解码内核 %s 与查表一致",
+                         law == RINGBACK_G711_ULAW ? "µ-law" : "A-law", kernel->name);
+                ASSERT(!memcmp(got, expect, sizeof(expect)), msg);
+            }
+        }
+
+        /* 用查表把 450Hz 信号编码回 µ-law，再走原生路径 */
+        static const double freqs[] = { 450 };
+        int16_t pcm[GOERTZEL_N];
+        uint8_t ulaw[GOERTZEL_N];
+        ringback_bank_t bank;
+        ringback_stream_t st;
+        ringback_block_t blk_native, blk_linear;
+        generate_450hz_tone(pcm, GOERTZEL_N, 8000);
+        for (int i = 0; i < GOERTZEL_N; i++) {
+            int best = 0;
+            for (int c = 1; c < 256; c++) {
+                if (abs(ringback_ulaw_table[c] - pcm[i]) < abs(ringback_ulaw_table[best] - pcm[i])) best = c;
+            }
+            ulaw[i] = (uint8_t)best;
+            pcm[i] = ringback_ulaw_table[best];
+        }
+        ringback_bank_init(&bank, freqs, 1, SAMPLE_RATE);
+        ringback_stream_init(&st, &bank, GOERTZEL_N);
+        ringback_stream_feed_g711(&st, RINGBACK_G711_ULAW, ulaw, GOERTZEL_N, &blk_native, 1);
+        ringback_stream_init(&st, &bank, GOERTZEL_N);
+        ringback_stream_feed(&st, pcm, GOERTZEL_N, &blk_linear, 1);
+        ASSERT(blk_native.sumsq == blk_linear.sumsq && blk_native.power[0] == blk_linear.power[0],
+               "G.711 原生路径结果应与解码后的线性输入一致");
+    }
+
+    /* 11. 多相抽取 - 16k/48k 输入抽取到 8k 后 450Hz 功率不变，带外信号不混叠 */
+    {
+        static const double freqs[] = { 450, 2000 };
+        static int16_t wide[48 * 40], dec[8 * 40 + 1];
+        int16_t ref[GOERTZEL_N];
+        ringback_decim_t d;
+        ringback_bank_t bank;
+        int64_t p_ref[2], p_dec[2];
+        char msg[128];
+        int rates[] = { 16000, 48000 };
+
+        generate_450hz_tone(ref, GOERTZEL_N, 8000);
+        ringback_bank_init(&bank, freqs, 2, SAMPLE_RATE);
+        ringback_bank_process(&bank, ref, GOERTZEL_N);
+        ringback_bank_powers(&bank, p_ref);
+
+        for (int r = 0; r < 2; r++) {
+            int rate = rates[r], n = rate / 1000 * 40;   /* 40ms */
+            ASSERT(ringback_decim_init(&d, rate, SAMPLE_RATE) == 0 && d.factor == rate / SAMPLE_RATE,
+                   "整数倍率应可初始化抽取器");
+            for (int i = 0; i < n; i++) wide[i] = (int16_t)(8000 * sin(2 * M_PI * 450.0 * i / rate));
+            /* 分两段送入，验证跨帧相位延续 */
+            int nout = ringback_decim_process(&d, wide, n / 3, dec);
+            nout += ringback_decim_process(&d, wide + n / 3, n - n / 3, dec + nout);
+            ASSERT(nout == n / d.factor, "抽取输出样本数应为输入的 1/M");
+
+            /* 跳过 FIR 暖机段后取一块 */
+            ringback_bank_reset(&bank);
+            ringback_bank_process(&bank, dec + 2 * RINGBACK_DECIM_TAPS_PER_PHASE, GOERTZEL_N);
+            ringback_bank_powers(&bank, p_dec);
+            double db = 10 * log10((double)p_dec[0] / p_ref[0]);
+            snprintf(msg, sizeof(msg), "%dHz 抽取后 450Hz 功率偏差 %.2fdB 应 < 1dB", rate, db);
+            ASSERT(fabs(db) < 1.0, msg);
+        }
+
+        /* 48k 下 6000Hz 会混叠到 8k 的 2000Hz，抗混叠后应衰减 40dB 以上 */
+        ringback_decim_init(&d, 48000, SAMPLE_RATE);
+        for (int i = 0; i < 48 * 40; i++) wide[i] = (int16_t)(8000 * sin(2 * M_PI * 6000.0 * i / 48000));
+        ringback_decim_process(&d, wide, 48 * 40, dec);
+        for (int i = 0; i < GOERTZEL_N; i++) {
+            ref[i] = (int16_t)(8000 * sin(2 * M_PI * 2000.0 * i / SAMPLE_RATE));
+        }
+        ringback_bank_reset(&bank);
+        ringback_bank_process(&bank, ref, GOERTZEL_N);
+        ringback_bank_powers(&bank, p_ref);
+        ringback_bank_reset(&bank);
+        ringback_bank_process(&bank, dec + 2 * RINGBACK_DECIM_TAPS_PER_PHASE, GOERTZEL_N);
+        ringback_bank_powers(&bank, p_dec);
+        ASSERT(10 * log10((double)p_ref[1] / (p_dec[1] + 1)) > 40, "带外 6000Hz 混叠分量应衰减 40dB 以上");
+
+        ASSERT(ringback_decim_init(&d, 44100, SAMPLE_RATE) == -1, "非整数倍率应返回错误");
+    }
+
+    /* 12. 自校准 - 默认保留最宽的可用内核，其他内核明显更快时才换用 */
+    {
+        const ringback_kernel_t *best = ringback_dsp_calibrate(12), *widest = NULL;
+        int ok = 1;
+        for (int k = 0; k < ringback_kernel_count(); k++) {
+            const ringback_kernel_t *kernel = ringback_kernel_get(k);
+            if (kernel->supported()) widest = kernel;
+            if (!kernel->supported() && ringback_kernel_ns(kernel) != 0) ok = 0;
+        }
+        for (int k = 0; k < ringback_kernel_count(); k++) {
+            const ringback_kernel_t *kernel = ringback_kernel_get(k);
+            double ns = ringback_kernel_ns(kernel);
+            if (!kernel->supported()) continue;
+            /* 选中的是明显快于最宽内核者中最快的；保留最宽时没有内核明显更快 */
+            if (ns < ringback_kernel_ns(widest) * (1.0 - RINGBACK_CALIB_MARGIN) &&
+                (best == widest || ns < ringback_kernel_ns(best))) ok = 0;
+        }
+        if (best != widest &&
+            !(ringback_kernel_ns(best) < ringback_kernel_ns(widest) * (1.0 - RINGBACK_CALIB_MARGIN))) ok = 0;
+        ASSERT(best && best == ringback_kernel_current() && ringback_kernel_ns(best) > 0 && ok,
+               "自校准默认保留最宽内核，其他内核快出 10% 以上才换用");
+        printf("     (选中 %s, %.1f ns/帧)\n", best->name, ringback_kernel_ns(best));
+    }
+
+    /* 13. 跨通道批处理 - 每个槽位结果与单通道滤波器组一致 */
+    {
+        static const double freqs[] = { 350, 425, 440, 450, 480, 620 };
+        int nbins = (int)(sizeof(freqs) / sizeof(freqs[0]));
+        enum { NCH = 40 };
+        static int16_t chan[NCH][GOERTZEL_N];
+        int slots[NCH];
+        char msg[128];
+
+        for (int c = 0; c < NCH; c++) {
+            double f = freqs[c % nbins];
+            for (int i = 0; i < GOERTZEL_N; i++) {
+                chan[c][i] = (int16_t)((1000 + 200 * c) * sin(2 * M_PI * f * i / SAMPLE_RATE));
+            }
+        }
+
+        for (int k = 0; k < ringback_kernel_count(); k++) {
+            const ringback_kernel_t *kernel = ringback_kernel_get(k);
+            if (!kernel->supported()) continue;
+            ringback_kernel_select(kernel->name);
+
+            ringback_batch_t *batch = ringback_batch_create(NCH, freqs, nbins, SAMPLE_RATE);
+            for (int c = 0; c < NCH; c++) slots[c] = ringback_batch_acquire(batch, &chan[c]);
+            for (int c = 0; c < NCH; c++) {
+                /* 分两次写入，模拟一轮内到达两帧 */
+                ringback_batch_push(batch, slots[c], chan[c], 80);
+                ringback_batch_push(batch, slots[c], chan[c] + 80, GOERTZEL_N - 80);
+            }
+            ringback_batch_swap(batch);
+            ringback_batch_run(batch);
+            ringback_batch_publish(batch);
+
+            int ok = 1;
+            for (int c = 0; c < NCH; c++) {
+                ringback_bank_t bank;
+                int64_t powers[RINGBACK_BANK_MAX_BINS];
+                const ringback_batch_result_t *r = ringback_batch_result(batch, slots[c]);
+                ringback_bank_init(&bank, freqs, nbins, SAMPLE_RATE);
+                uint64_t sumsq = ringback_bank_process(&bank, chan[c], GOERTZEL_N);
+                ringback_bank_powers(&bank, powers);
+                if (r->count != GOERTZEL_N || r->sumsq != sumsq ||
+                    memcmp(r->power, powers, nbins * sizeof(int64_t))) {
+                    ok = 0;
+                }
+            }
+            snprintf(msg, sizeof(msg), "批处理内核 %s 与单通道滤波器组逐位一致", kernel->name);
+            ASSERT(ok, msg);
+
+            /* 只有部分通道有数据、且长度不同：短通道补零后功率误差 < 1% */
+            ringback_batch_push(batch, slots[3], chan[3], 160);
+            ringback_batch_push(batch, slots[5], chan[5], GOERTZEL_N);
+            ringback_batch_swap(batch);
+            ringback_batch_run(batch);
+            ringback_batch_publish(batch);
+            {
+                ringback_bank_t bank;
+                int64_t powers[RINGBACK_BANK_MAX_BINS];
+                const ringback_batch_result_t *r = ringback_batch_result(batch, slots[3]);
+                int bin = 3 % nbins;
+                ringback_bank_init(&bank, freqs, nbins, SAMPLE_RATE);
+                ringback_bank_process(&bank, chan[3], 160);
+                ringback_bank_powers(&bank, powers);
+                snprintf(msg, sizeof(msg), "批处理内核 %s 补零通道功率一致、空闲通道无数据", kernel->name);
+                ASSERT(r->count == 160 && fabs((double)r->power[bin] - powers[bin]) < powers[bin] * 0.01 &&
+                       ringback_batch_result(batch, slots[0])->count == 0, msg);
+            }
+            ringback_batch_destroy(batch);
+        }
+        ringback_dsp_init();
+
+        ringback_batch_t *batch = ringback_batch_create(20, freqs, nbins, SAMPLE_RATE);
+        int a = ringback_batch_acquire(batch, &chan[0]);
+        int b = ringback_batch_acquire(batch, &chan[1]);
+        ASSERT(a == 0 && b == 1 && ringback_batch_owner(batch, b) == &chan[1], "批处理槽位分配");
+        for (int t = 0; t < 5; t++) {
+            ringback_batch_push(batch, a, chan[0], 160);
+            ringback_batch_swap(batch);
+            ringback_batch_run(batch);
+            ringback_batch_publish(batch);
+        }
+        ASSERT(ringback_batch_reap(batch, 3) == 1 && ringback_batch_owner(batch, b) == NULL &&
+               ringback_batch_owner(batch, a) == &chan[0], "长时间无数据的槽位应被回收");
+        ringback_batch_destroy(batch);
+
+        /*
+         * 30/60ms 打包：计算周期 20ms，两帧之间有空轮。按模块的顺序 (写入后立即取走，
+         * 之后各轮计算)，每帧的块都应被取到，样本数和平方和没有丢失
+         */
+        {
+            static const int ptime[] = { 30, 60 };
+            static int16_t tone[RINGBACK_BATCH_MAX_SAMPLES];
+            ringback_batch_result_t res[RINGBACK_BATCH_PENDING];
+            generate_450hz_tone(tone, RINGBACK_BATCH_MAX_SAMPLES, 8000);
+
+            for (int p = 0; p < 2; p++) {
+                int len = ptime[p] * SAMPLE_RATE / 1000, nframes = 0, nres = 0, samples = 0, sized = 1;
+                uint64_t sumsq = 0, expect = 0;
+
+                batch = ringback_batch_create(20, freqs, nbins, SAMPLE_RATE);
+                a = ringback_batch_acquire(batch, &chan[0]);
+                /* 以 10ms 为步长：每 ptime 到达一帧，每 20ms 一轮计算，最后再算一轮收尾 */
+                for (int t = 0; t <= 120; t += 10) {
+                    int n = 0;
+                    if (t % ptime[p] == 0 && t < 120) {
+                        ringback_batch_push(batch, a, tone, len);
+                        expect += ringback_energy_sumsq(tone, len);
+                        nframes++;
+                        n = ringback_batch_take(batch, a, res, RINGBACK_BATCH_PENDING);
+                    }
+                    if (t % 20 == 10 || t == 120) {
+                        ringback_batch_swap(batch);
+                        ringback_batch_run(batch);
+                        ringback_batch_publish(batch);
+                    }
+                    if (t == 120) {
+                        n = ringback_batch_take(batch, a, res, RINGBACK_BATCH_PENDING);
+                    }
+                    for (int i = 0; i < n; i++) {
+                        sized &= res[i].count == len;
+                        samples += res[i].count;
+                        sumsq += res[i].sumsq;
+                    }
+                    nres += n;
+                }
+                snprintf(msg, sizeof(msg), "批处理 %dms 打包：每帧一个块，空轮不覆盖未取走的结果", ptime[p]);
+                ASSERT(nres == nframes && sized && samples == nframes * len && sumsq == expect, msg);
+                ringback_batch_destroy(batch);
+            }
+        }
+    }
+
+    /* 14. 时序自动机 - 响停两段都校验，多段模式，任意相位接入 */
+    {
+        static ringback_cadence_t cad;
+        ringback_cadence_rule_t rules[3];
+        ringback_cadence_state_t st;
+        int m, i;
+
+        ASSERT(ringback_cadence_parse(&rules[0], "busy", 1, "300-400|250-400", 2) == 0 &&
+               rules[0].nseg == 2 && rules[0].min_ms[1] == 250 && rules[0].max_ms[1] == 400,
+               "解析 响|停 规则");
+        ASSERT(ringback_cadence_parse(&rules[1], "x", 0, "300-|250", 1) == -1 &&
+               ringback_cadence_parse(&rules[1], "x", 0, "400-300", 1) == -1,
+               "格式错误的规则应拒绝");
+        ringback_cadence_parse(&rules[1], "congestion", 3, "600-750|500-750", 2);
+        ringback_cadence_parse(&rules[2], "uk_ringback", 2, "350-450|150-250|350-450|1800-2200", 1);
+        ASSERT(ringback_cadence_compile(&cad, rules, 3) == 0, "编译规则表");
+
+        /* 忙音：两个完整周期后在第二个停段结束时匹配 */
+        ringback_cadence_reset(&st);
+        m = ringback_cadence_step(&cad, &st, 1, 350);
+        m = m < 0 ? ringback_cadence_step(&cad, &st, 0, 340) : m;
+        m = m < 0 ? ringback_cadence_step(&cad, &st, 1, 360) : m;
+        ASSERT(m == -1, "忙音不足两个周期不应匹配");
+        ASSERT(ringback_cadence_step(&cad, &st, 0, 350) == 0, "忙音两个周期应匹配");
+
+        /* 响长符合忙音但停长不符：旧实现忽略停长会误判 */
+        ringback_cadence_reset(&st);
+        m = -1;
+        for (i = 0; i < 4 && m < 0; i++) {
+            m = ringback_cadence_step(&cad, &st, 1, 350);
+            m = m < 0 ? ringback_cadence_step(&cad, &st, 0, 1500) : m;
+        }
+        ASSERT(m == -1, "停长不符的序列不应匹配忙音");
+
+        ringback_cadence_reset(&st);
+        m = -1;
+        for (i = 0; i < 2 && m < 0; i++) {
+            m = ringback_cadence_step(&cad, &st, 1, 700);
+            m = m < 0 ? ringback_cadence_step(&cad, &st, 0, 700) : m;
+        }
+        ASSERT(m == 1, "拥塞音应匹配");
+
+        /* 双振铃：从第二响中途接入，下一完整周期对齐 */
+        {
+            static const uint32_t seq[] = { 200, 2000, 400, 200, 400, 2000 };
+            ringback_cadence_reset(&st);
+            m = -1;
+            for (i = 0; i < 6; i++) {
+                int r = ringback_cadence_step(&cad, &st, !(i & 1), seq[i]);
+                if (r >= 0) {
+                    m = r;
+                    break;
+                }
+            }
+            ASSERT(m == 2 && i == 5, "英式双振铃应在完整周期结束时匹配");
+        }
+    }
+
+    /* 15. 多国方案并行 - 同一滤波器组输出上同时匹配中/美/英方案，按频率和时序区分 */
+    {
+        static const double freqs[] = { 350, 400, 425, 440, 450, 480, 620, 913.8,
+                                        985.2, 1370.6, 1428.5, 1776.7 };
+        static ringback_toneset_t ts;
+        static const int us_busy[] = { 500, 500 }, cn_busy[] = { 350, 350 };
+        static const int uk_ring[] = { 400, 200, 400, 2000 };
+        uint64_t rules;
+        int r;
+
+        ASSERT(ringback_country_find("CN") != NULL && ringback_country_find("zz") == NULL, "内置国家方案查找");
+        ringback_toneset_init(&ts, freqs, 12);
+        for (int i = 0; i < ringback_country_count(); i++) {
+            ringback_toneset_add_country(&ts, ringback_country_get(i));
+        }
+        ASSERT(ringback_toneset_compile(&ts) == 0 && ts.nsig <= RINGBACK_TONESET_MAX_SIGS,
+               "全部内置方案应能编译进同一规则表");
+
+        rules = ringback_toneset_select(&ts, "cn,us,uk");
+        ASSERT(rules && rules != ringback_toneset_select(&ts, "all") && ringback_toneset_select(&ts, "zz") == 0,
+               "方案选择");
+
+        r = run_cadence(&ts, rules, 480, 620, us_busy, 2, 3);
+        ASSERT(r >= 0 && !strcmp(ts.rules[r].name, "us.busy"), "480+620 500/500 应识别为美国忙音");
+        r = run_cadence(&ts, rules, 450, 0, cn_busy, 2, 3);
+        ASSERT(r >= 0 && ts.rules[r].tone == RINGBACK_TONE_BUSY && !strcmp(ts.rules[r].name, "cn.busy"),
+               "450 350/350 应识别为中国忙音");
+        r = run_cadence(&ts, rules, 400, 450, uk_ring, 4, 2);
+        ASSERT(r >= 0 && !strcmp(ts.rules[r].name, "uk.ringback"), "400+450 双振铃应识别为英国回铃音");
+        r = run_cadence(&ts, ringback_toneset_select(&ts, "cn"), 480, 620, us_busy, 2, 3);
+        ASSERT(r == -1, "未选中的方案不应命中");
+    }
+
+    /* 16. 被叫前缀路由 - 最长前缀匹配，忽略前导 +，遇非数字停止 */
+    {
+        ringback_prefix_t t;
+
+        ASSERT(ringback_prefix_init(&t) == 0, "前缀树初始化");
+        ASSERT(ringback_prefix_add(&t, "86", 1) == 0 && ringback_prefix_add(&t, "+8610", 2) == 0 &&
+               ringback_prefix_add(&t, "1", 3) == 0, "添加前缀");
+        ASSERT(ringback_prefix_add(&t, "", 4) == -1 && ringback_prefix_add(&t, "86a", 4) == -1, "非法前缀应拒绝");
+        ASSERT(ringback_prefix_lookup(&t, "8613800138000") == 1, "86 开头匹配中国路由");
+        ASSERT(ringback_prefix_lookup(&t, "+861012345678") == 2, "最长前缀优先");
+        ASSERT(ringback_prefix_lookup(&t, "12125551234") == 3, "1 开头匹配北美路由");
+        ASSERT(ringback_prefix_lookup(&t, "4420") == -1 && ringback_prefix_lookup(&t, NULL) == -1, "无匹配返回 -1");
+        ASSERT(ringback_prefix_lookup(&t, "8@10") == -1 && ringback_prefix_lookup(&t, "86@10") == 1,
+               "遇非数字停止匹配");
+        ringback_prefix_add(&t, "86", 5);
+        ASSERT(ringback_prefix_lookup(&t, "8613800138000") == 5, "重复前缀覆盖旧值");
+        ringback_prefix_destroy(&t);
+    }
+
+    /* 17. 置信度早判 - 干净的忙音第一个周期即判定，比完整匹配两周期更快 */
+    {
+        static const double freqs[] = { 350, 400, 425, 440, 450, 480, 620, 913.8,
+                                        985.2, 1370.6, 1428.5, 1776.7 };
+        static ringback_toneset_t ts;
+        static const int cn_busy[] = { 350, 350 }, us_ring[] = { 2000, 4000 };
+        uint32_t full_ms;
+        uint64_t rules;
+        int r;
+
+        ringback_toneset_init(&ts, freqs, 12);
+        for (int i = 0; i < ringback_country_count(); i++) {
+            ringback_toneset_add_country(&ts, ringback_country_get(i));
+        }
+        ringback_toneset_compile(&ts);
+        rules = ringback_toneset_select(&ts, "cn,us,uk");
+
+        r = run_cadence(&ts, rules, 450, 0, cn_busy, 2, 4);
+        full_ms = cadence_verdict_ms;
+        ASSERT(r >= 0 && ts.rules[r].tone == RINGBACK_TONE_BUSY && cadence_confidence == 1.0f,
+               "早判关闭时按完整匹配判定，置信度为 1");
+
+        ts.confidence = 0.9;
+        r = run_cadence(&ts, rules, 450, 0, cn_busy, 2, 4);
+        printf("    忙音判定: 完整匹配 %u ms, 早判 %u ms (置信度 %.3f)\n", full_ms, cadence_verdict_ms,
+               cadence_confidence);
+        ASSERT(r >= 0 && ts.rules[r].tone == RINGBACK_TONE_BUSY, "早判应识别为忙音");
+        ASSERT(cadence_verdict_ms + 300 <= full_ms && cadence_verdict_ms <= 800, "早判应在第一个周期内完成");
+        ASSERT(cadence_confidence >= 0.9f && cadence_confidence < 1.0f, "早判置信度在阈值与 1 之间");
+
+        r = run_cadence(&ts, rules, 440, 480, us_ring, 2, 2);
+        ASSERT(r >= 0 && ts.rules[r].tone == RINGBACK_TONE_RINGBACK, "早判不影响回铃音识别");
+
+        ts.confidence = 0.999;
+        r = run_cadence(&ts, rules, 450, 0, cn_busy, 2, 4);
+        ASSERT(r >= 0 && cadence_verdict_ms > 800, "阈值更高时需要更多周期");
+    }
+
+    /* 18. 频率校验 - 纯度、双频扭曲、谐波，噪声和语音类信号不算有音 */
+    {
+        static const double freqs[] = { 350, 400, 425, 440, 450, 480, 620, 913.8,
+                                        985.2, 1370.6, 1428.5, 1776.7 };
+        static ringback_toneset_t ts;
+        uint32_t b450 = 1u << 4, b480_620 = (1u << 5) | (1u << 6);
+        int16_t buf[GOERTZEL_N];
+
+        ringback_toneset_init(&ts, freqs, 12);
+        for (int i = 0; i < ringback_country_count(); i++) {
+            ringback_toneset_add_country(&ts, ringback_country_get(i));
+        }
+        ringback_toneset_compile(&ts);
+        ASSERT(ts.sig_harm[0] || ts.sig_harm[1] || ts.sig_harm[2], "应找到谐波校验频点 (900 -> 913.8)");
+
+        srand(1);
+        for (int i = 0; i < GOERTZEL_N; i++) {
+            double t = (double)i / SAMPLE_RATE;
+            buf[i] = (int16_t)(4000 * sin(2 * M_PI * 450 * t));
+        }
+        ASSERT(sig_on(&ts, b450, buf) == 1, "纯 450Hz 应判为有音");
+
+        for (int i = 0; i < GOERTZEL_N; i++) {
+            double t = (double)i / SAMPLE_RATE;
+            buf[i] = (int16_t)(4000 * sin(2 * M_PI * 450 * t) + 4000 * sin(2 * M_PI * 900 * t + 0.3));
+        }
+        ASSERT(sig_on(&ts, b450, buf) == 0, "强二次谐波应拒绝");
+
+        for (int i = 0; i < GOERTZEL_N; i++) {
+            double t = (double)i / SAMPLE_RATE;
+            buf[i] = (int16_t)(2000 * sin(2 * M_PI * 450 * t) + (rand() % 12001 - 6000));
+        }
+        ASSERT(sig_on(&ts, b450, buf) == 0, "强噪声中纯度不足应拒绝");
+
+        for (int i = 0; i < GOERTZEL_N; i++) {
+            double t = (double)i / SAMPLE_RATE, v = 0;
+            for (int k = 1; k <= 12; k++) {
+                v += 3000.0 / k * sin(2 * M_PI * 150 * k * t);     /* 浊音：150Hz 基频锯齿波 */
+            }
+            buf[i] = (int16_t)v;
+        }
+        ASSERT(sig_on(&ts, b450, buf) == 0, "谐波丰富的浊音不应判为 450Hz 有音");
+
+        for (int i = 0; i < GOERTZEL_N; i++) {
+            double t = (double)i / SAMPLE_RATE;
+            buf[i] = (int16_t)(4000 * sin(2 * M_PI * 480 * t) + 1600 * sin(2 * M_PI * 620 * t));
+        }
+        ASSERT(sig_on(&ts, b480_620, buf) == 1, "双频扭曲 8dB 在允许范围内");
+
+        for (int i = 0; i < GOERTZEL_N; i++) {
+            double t = (double)i / SAMPLE_RATE;
+            buf[i] = (int16_t)(4000 * sin(2 * M_PI * 480 * t) + 600 * sin(2 * M_PI * 620 * t));
+        }
+        ASSERT(sig_on(&ts, b480_620, buf) == 0, "双频扭曲 16dB 应拒绝");
+    }
+
+    /* 19. 自适应噪声基底与施密特门限 - 安静线路、噪声线路、响段内短暂掉音 */
+    {
+        static const double freqs[] = { 350, 400, 425, 440, 450, 480, 620, 913.8,
+                                        985.2, 1370.6, 1428.5, 1776.7 };
+        static ringback_toneset_t ts, energy_ts;
+        static const int cn_busy[] = { 350, 350 };
+        ringback_cadence_rule_t rule;
+        uint64_t rules;
+        int r;
+
+        srand(2);
+        ringback_toneset_init(&ts, freqs, 12);
+        ringback_toneset_add_country(&ts, ringback_country_find("cn"));
+        ringback_toneset_compile(&ts);
+        rules = ringback_toneset_select(&ts, "cn");
+
+        /* -33dBm0 左右 (RMS 约 350)：低于旧的固定门限 500，按低绝对门限加信噪比仍可识别 */
+        r = run_cadence_ex(&ts, rules, 450, 0, cn_busy, 2, 4, 500, 30, 0, 100);
+        ASSERT(r >= 0 && ts.rules[r].tone == RINGBACK_TONE_BUSY, "安静线路上的弱忙音应识别");
+
+        /* 只按能量的规则：噪声 RMS 约 700 高于绝对门限，开头即响段，靠窗口最小值纠正噪声基底后区分响停 */
+        ringback_toneset_init(&energy_ts, freqs, 12);
+        ringback_cadence_parse(&rule, "busy", RINGBACK_TONE_BUSY, "300-400|250-400", 2);
+        ringback_toneset_add_rule(&energy_ts, "default", &rule, NULL, 0);
+        ringback_toneset_compile(&energy_ts);
+        r = run_cadence_ex(&energy_ts, ~UINT64_C(0), 450, 0, cn_busy, 2, 8, 4000, 1200, 0, ENERGY_THRESHOLD);
+        ASSERT(r == 0, "噪声线路上按噪声基底切分响停段");
+        ASSERT(cadence_track.noise_floor > 300000 && cadence_track.noise_floor < 700000,
+               "噪声基底应收敛到噪声均方值附近");
+
+        /* 响段中间 20ms 掉音 (丢包/CNG)：桥接后时序不受影响 */
+        r = run_cadence_ex(&ts, rules, 450, 0, cn_busy, 2, 4, 4000, 0, 20, ENERGY_THRESHOLD);
+        ASSERT(r >= 0 && ts.rules[r].tone == RINGBACK_TONE_BUSY, "短暂掉音应被桥接");
+        ts.min_gap_ms = 0;
+        r = run_cadence_ex(&ts, rules, 450, 0, cn_busy, 2, 4, 4000, 0, 20, ENERGY_THRESHOLD);
+        ASSERT(r == -1, "不桥接时掉音把响段切碎，无法匹配");
+    }
+
+    /* 20. 块内边沿定位 - 子块包络把响停边沿定位到 1ms，而不是 20ms 块边界 */
+    {
+        static const double freqs[] = { 350, 400, 425, 440, 450, 480, 620, 913.8,
+                                        985.2, 1370.6, 1428.5, 1776.7 };
+        static ringback_toneset_t ts;
+        static ringback_tonetrack_t tr;
+        static int16_t buf[SAMPLE_RATE];
+        ringback_bank_t bank;
+        ringback_stream_t st;
+        ringback_block_t blocks[RINGBACK_STREAM_MAX_BLOCKS];
+        int on_ms = 37, off_ms = 390, s450 = -1;
+
+        ringback_toneset_init(&ts, freqs, 12);
+        ringback_toneset_add_country(&ts, ringback_country_find("cn"));
+        ringback_toneset_compile(&ts);
+        for (int s = 0; s < ts.nsig; s++) {
+            if (ts.sig_bins[s] == 1u << 4) {
+                s450 = s;
+            }
+        }
+
+        for (int i = 0; i < SAMPLE_RATE; i++) {
+            int ms = i * 1000 / SAMPLE_RATE;
+            buf[i] = ms >= on_ms && ms < off_ms ? (int16_t)(4000 * sin(2 * M_PI * 450 * i / SAMPLE_RATE)) : 0;
+        }
+
+        ringback_bank_init(&bank, ts.freqs, ts.nbins, SAMPLE_RATE);
+        ringback_stream_init(&st, &bank, GOERTZEL_N);
+        ringback_tonetrack_reset(&tr);
+        for (int f = 0; f < SAMPLE_RATE / 2; f += 160) {
+            int nb = ringback_stream_feed(&st, buf + f, 160, blocks, RINGBACK_STREAM_MAX_BLOCKS);
+            for (int b = 0; b < nb; b++) {
+                if (blocks[b].end_sample == 40 * SAMPLE_RATE / 1000) {
+                    ASSERT(blocks[b].env_n == RINGBACK_ENV_SLOTS && blocks[b].env[16] == 0 &&
+                           blocks[b].env[18] > 1000000, "包络：块内 37ms 起音前为 0，之后为信号电平");
+                }
+                ringback_tonetrack_block(&ts, &tr, ~UINT64_C(0), &blocks[b], ENERGY_THRESHOLD,
+                                         (uint32_t)(blocks[b].end_sample * 1000 / SAMPLE_RATE));
+            }
+        }
+        ASSERT(s450 >= 0 && abs((int)tr.sig[s450].tone_start_ms - on_ms) <= 1, "起音边沿误差不超过 1ms");
+        ASSERT(s450 >= 0 && abs((int)tr.sig[s450].silence_start_ms - off_ms) <= 1, "收音边沿误差不超过 1ms");
+    }
+
+    /* 21. 判定后低开销监视 - 回铃音持续时不回到完整分析，语音、静音、连续提示音时回到完整分析 */
+    {
+        static const double freqs[] = { 350, 400, 425, 440, 450, 480, 620, 913.8,
+                                        985.2, 1370.6, 1428.5, 1776.7 };
+        static const int cn_ring[] = { 1000, 4000 };
+        static ringback_toneset_t ts;
+        ringback_monitor_t m;
+        uint32_t t, t0, resumed;
+        int r, cycle;
+
+        ringback_toneset_init(&ts, freqs, 12);
+        ringback_toneset_add_country(&ts, ringback_country_find("cn"));
+        ringback_toneset_compile(&ts);
+        r = run_cadence(&ts, ~UINT64_C(0), 450, 0, cn_ring, 2, 3);
+        ASSERT(r >= 0 && ts.rules[r].tone == RINGBACK_TONE_RINGBACK, "监视：先识别出回铃音");
+        ASSERT(ringback_monitor_start(&m, &ts, &cadence_track, r, cadence_verdict_ms) == 0 && m.active,
+               "回铃音判定后进入监视");
+        ASSERT(m.on_level > 4000.0 * 4000 / 4 && m.on_level < 4000.0 * 4000, "监视：响段电平取判定时的均方值");
+
+        /* 判定多在响段开始：先补完当前响段，之后回铃音照常继续 */
+        t = cadence_verdict_ms;
+        resumed = run_monitor(&m, &t, 1000 - (int)(t - cadence_track.sig[ts.rule_sig[r]].tone_start_ms), 4000, 0);
+        for (cycle = 0; cycle < 3 && !resumed; cycle++) {
+            resumed = run_monitor(&m, &t, 4000, 0, 0);
+            if (!resumed) {
+                resumed = run_monitor(&m, &t, 1000, 4000, 0);
+            }
+        }
+        ASSERT(!resumed && m.active, "回铃音持续时一直保持监视");
+
+        /* 接通后的语音：电平起伏，两次检查即回到完整分析 */
+        t0 = t;
+        resumed = run_monitor(&m, &t, 1000, 6000, 1);
+        ASSERT(resumed && !m.active && resumed - t0 <= 300, "出现语音后很快回到完整分析");
+
+        /* 停止振铃后长时间静音：超过规则最长停段才回到完整分析 */
+        ringback_monitor_start(&m, &ts, &cadence_track, r, t);
+        t0 = t;
+        resumed = run_monitor(&m, &t, 8000, 0, 0);
+        ASSERT(resumed > 0 && resumed - t0 > 4000 && resumed - t0 <= 6000,
+               "静音超过最长停段后回到完整分析");
+
+        /* 同电平的连续提示音：超过规则最长响段即回到完整分析 */
+        ringback_monitor_start(&m, &ts, &cadence_track, r, t);
+        t0 = t;
+        resumed = run_monitor(&m, &t, 4000, 4000, 0);
+        ASSERT(resumed > 0 && resumed - t0 <= 2000, "连续单音超过最长响段后回到完整分析");
+    }
+
+    /* 22. 时间轮 - 各层跨度的定时器都在到期节拍准时触发，取消和改期 O(1) */
+    {
+        static ringback_wheel_t w;
+        static ringback_timer_t timers[16];
+        static const uint64_t due[] = { 0, 1, 63, 64, 65, 4095, 4096, 4097, 262143, 262144, 300000, 5000 };
+        uint64_t period = 7, tick;
+        int i, ok = 1;
+
+        wheel_under_test = &w;
+        ringback_wheel_init(&w, 1000);
+        for (i = 0; i < 12; i++) {
+            ringback_timer_init(&timers[i], wheel_record, NULL);
+            ringback_wheel_add(&w, &timers[i], 1000 + due[i]);
+        }
+        ASSERT(w.count == 12 && ringback_timer_pending(&timers[11]), "时间轮：加入后挂在轮上");
+
+        /* 取消一个、把一个改期到更早 */
+        ringback_wheel_cancel(&w, &timers[11]);
+        ringback_wheel_add(&w, &timers[10], 1000 + 200);
+        ASSERT(w.count == 11 && !ringback_timer_pending(&timers[11]), "时间轮：取消后不再挂着");
+
+        wheel_fired_n = 0;
+        for (tick = 1000; tick <= 1000 + 300000 && ok; tick++) {
+            int before = wheel_fired_n;
+            ringback_wheel_advance(&w, tick);
+            for (i = before; i < wheel_fired_n && i < 64; i++) {
+                if (wheel_fired_at[i] != tick) {
+                    ok = 0;
+                }
+            }
+        }
+        ASSERT(ok && wheel_fired_n == 11 && w.count == 0, "时间轮：跨层定时器都在到期节拍触发，取消的不触发");
+
+        /* 一次推进很多拍 (线程被延迟)：过期的全部触发 */
+        wheel_fired_n = 0;
+        for (i = 0; i < 10; i++) {
+            ringback_wheel_add(&w, &timers[i], tick + (uint64_t)i * 1000);
+        }
+        ASSERT(ringback_wheel_advance(&w, tick + 100000) == 10 && w.count == 0, "时间轮：一次推进多拍时全部到期");
+
+        /* 回调中改期：周期定时器每 period 拍触发一次 */
+        tick += 100001;
+        wheel_fired_n = 0;
+        ringback_timer_init(&timers[12], wheel_rearm, &period);
+        ringback_wheel_add(&w, &timers[12], tick + period);
+        ringback_wheel_advance(&w, tick + 70);
+        ASSERT(wheel_fired_n == 10 && ringback_timer_pending(&timers[12]), "时间轮：回调中改期的周期定时器");
+        ringback_wheel_cancel(&w, &timers[12]);
+
+        /* 已过期的截止时刻在下一次推进时触发 */
+        wheel_fired_n = 0;
+        ringback_wheel_add(&w, &timers[0], 5);
+        ASSERT(ringback_wheel_advance(&w, w.now) == 1, "时间轮：已过期的定时器下一拍触发");
+    }
+
+    /* 23. 单生产者单消费者帧队列 - 满时丢帧，跨线程按序交付 */
+    {
+        static ringback_ring_t ring;
+        const ringback_ring_frame_t *f;
+        static int16_t pcm[1440];  /* 30ms @ 48kHz */
+        pthread_t th;
+        uint32_t expect = 0;
+        int i, pushed = 0, ok = 1;
+
+        ringback_ring_init(&ring);
+        ASSERT(ringback_ring_empty(&ring) && !ringback_ring_peek(&ring), "队列：初始为空");
+        for (i = 0; i < 1440; i++) {
+            pcm[i] = (int16_t)i;
+        }
+        for (i = 0; i < RINGBACK_RING_SLOTS + 3; i++) {
+            pushed += ringback_ring_push(&ring, pcm, 320, 160, 8000, i * 160, (uint16_t)i, 0) == RINGBACK_RING_OK;
+        }
+        ASSERT(pushed == RINGBACK_RING_SLOTS && ring.dropped == 3, "队列：满时丢弃新帧并计数");
+        f = ringback_ring_peek(&ring);
+        ASSERT(f && f->seq == 0 && f->datalen == 320 && f->samples == 160 && !memcmp(f->data, pcm, 320),
+               "队列：取出最早的一帧，载荷和帧头完整");
+        ringback_ring_pop(&ring);
+        ASSERT(ringback_ring_push(&ring, NULL, 0, 160, 8000, 0, 99, 1) == RINGBACK_RING_OK,
+               "队列：出队后可再写入 (无载荷 CNG 帧)");
+        ASSERT(ringback_ring_push(&ring, pcm, RINGBACK_RING_FRAME_BYTES + 1, 0, 8000, 0, 0, 0) ==
+               RINGBACK_RING_TOO_LONG && ring.dropped == 3, "队列：超长帧拒绝写入，不计丢弃");
+
+        /* 30ms L16 @ 48kHz (2880 字节) 完整入队 */
+        ringback_ring_init(&ring);
+        ASSERT(ringback_ring_push(&ring, pcm, sizeof(pcm), 1440, 48000, 0, 1, 0) == RINGBACK_RING_OK &&
+               ring.dropped == 0, "队列：30ms@48kHz 帧入队");
+        f = ringback_ring_peek(&ring);
+        ASSERT(f && f->datalen == 2880 && f->samples == 1440 && f->rate == 48000 && !memcmp(f->data, pcm, sizeof(pcm)),
+               "队列：30ms@48kHz 帧载荷完整");
+
+        ringback_ring_init(&ring);
+        pthread_create(&th, NULL, ring_producer, &ring);
+        while (expect < RING_TEST_FRAMES) {
+            if ((f = ringback_ring_peek(&ring))) {
+                uint32_t v;
+                memcpy(&v, f->data, sizeof(v));
+                if (v != expect || f->timestamp != expect) {
+                    ok = 0;
+                }
+                expect++;
+                ringback_ring_pop(&ring);
+            } else {
+                sched_yield();
+            }
+        }
+        pthread_join(th, NULL);
+        ASSERT(ok && ringback_ring_empty(&ring), "队列：跨线程交付不丢不乱序");
+    }
+
+    /* 24. 分片统计 - 直方图按 2 的幂分桶，分位数取桶上界，各分片汇总 */
+    {
+        static ringback_stats_t st;
+        ringback_stats_shard_t sum;
+        uint64_t t0, t1;
+        int i, shard = -1, ok = 1;
+
+        ASSERT(ringback_hist_bucket(0) == 0 && ringback_hist_bucket(1) == 1 && ringback_hist_bucket(3) == 2 &&
+               ringback_hist_bucket(4) == 3 && ringback_hist_bucket(UINT64_MAX) == RINGBACK_HIST_BUCKETS - 1,
+               "统计：桶 i 含 [2^(i-1), 2^i)，超出的落在最后一桶");
+        for (i = 0; i < RINGBACK_HIST_BUCKETS; i++) {
+            ok &= ringback_hist_bucket(ringback_hist_bound(i)) == i;
+        }
+        ASSERT(ok, "统计：桶上界落在本桶");
+
+        for (i = 0; i < 99; i++) {
+            ringback_hist_add(&st.shard[i % RINGBACK_STATS_SHARDS].callback_ns, 1000);
+            ringback_stats_inc(&st, i % RINGBACK_STATS_SHARDS, RINGBACK_STAT_FRAMES);
+        }
+        ringback_hist_add(&st.shard[5].callback_ns, 100000);
+        ringback_stats_inc(&st, 63, RINGBACK_STAT_TIMEOUTS);
+        ringback_stats_sum(&st, &sum);
+        ASSERT(sum.counter[RINGBACK_STAT_FRAMES] == 99 && sum.counter[RINGBACK_STAT_TIMEOUTS] == 1 &&
+               sum.callback_ns.count == 100 && sum.callback_ns.sum == 99 * 1000 + 100000,
+               "统计：各分片计数和直方图汇总");
+        ASSERT(ringback_hist_quantile(&sum.callback_ns, 0.5) == 1023 &&
+               ringback_hist_quantile(&sum.callback_ns, 0.99) == 1023 &&
+               ringback_hist_quantile(&sum.callback_ns, 1.0) == 131071, "统计：分位数取所在桶上界");
+        ASSERT(ringback_hist_quantile(&sum.verdict_ms, 0.5) == 0, "统计：无样本分位数为 0");
+
+        ringback_stats_clock_init();
+        t0 = ringback_stats_clock(&shard);
+        {
+            struct timespec ts = { 0, 2000000 };
+            nanosleep(&ts, NULL);
+        }
+        t1 = ringback_stats_clock(NULL);
+        ASSERT(shard >= 0 && shard < RINGBACK_STATS_SHARDS, "统计：分片编号在范围内");
+        ASSERT(ringback_stats_clock_ns(t1 - t0) >= 1500000 && ringback_stats_clock_ns(t1 - t0) < 1000000000,
+               "统计：时钟校准后换算为纳秒");
+        ASSERT(!strcmp(ringback_stat_name(RINGBACK_STAT_VERDICT_BUSY), "verdicts_busy") &&
+               !strcmp(ringback_stat_name(RINGBACK_STAT_COUNTERS), "unknown"), "统计：计数器名称");
+    }
+
+    /* 25. 判定跟踪 - 定长记录环形覆盖，快照按时间顺序，解码为文本 */
+    {
+        static ringback_trace_rec_t slots[8], out[8];
+        static const double freqs[2] = { 425.0, 450.0 };
+        ringback_trace_t tr;
+        int64_t power[2] = { 0, 1 << 20 };
+        char line[256];
+        int i, n;
+
+        ASSERT(ringback_trace_log2(0) == 0 && ringback_trace_log2(1) == 0 && ringback_trace_log2(2) == 256 &&
+               ringback_trace_log2(3) == 256 + 128 && ringback_trace_log2(UINT64_C(1) << 40) == 40 * 256,
+               "跟踪：log2 Q8 定点量化");
+        ASSERT(fabs(ringback_trace_db(ringback_trace_log2(1000000)) - 60.0) < 0.3, "跟踪：量化后换算 dB 误差小");
+
+        ringback_trace_init(&tr, slots, 0);
+        ringback_trace_block(&tr, 20, 100, 160, power, 2, 0);
+        ASSERT(tr.head == 0 && ringback_trace_snapshot(&tr, out, 8) == 0, "跟踪：size 为 0 时关闭");
+
+        ringback_trace_init(&tr, slots, 8);
+        ringback_trace_block(&tr, 20, 160 * 1000, 160, power, 2, 0x1);
+        ringback_trace_edge(&tr, 15, 0, 1, 4000);
+        ringback_trace_rule(&tr, 20, 3, 0x02, 0.95f);
+        n = ringback_trace_snapshot(&tr, out, 8);
+        ASSERT(n == 3 && out[0].type == RINGBACK_TRACE_BLOCK && out[0].flags == 1 && out[0].power[0] == 0 &&
+               out[0].power[1] == 20 * 256 && out[1].type == RINGBACK_TRACE_EDGE && out[1].value == 4000 &&
+               out[2].type == RINGBACK_TRACE_RULE && out[2].idx == 3 && out[2].value == 950,
+               "跟踪：块、边沿、规则记录按写入顺序");
+
+        ringback_trace_format(&out[0], freqs, 2, NULL, line, sizeof(line));
+        ASSERT(strstr(line, "block") && strstr(line, "450:60.2"), "跟踪：块记录解码含频点功率 dB");
+        ringback_trace_format(&out[1], freqs, 2, NULL, line, sizeof(line));
+        ASSERT(strstr(line, "sig 0 on") && strstr(line, "4000 ms"), "跟踪：边沿记录解码");
+        ringback_trace_format(&out[2], freqs, 2, NULL, line, sizeof(line));
+        ASSERT(strstr(line, "#3") && strstr(line, "0.950"), "跟踪：无规则表时按下标解码");
+
+        for (i = 0; i < 20; i++) {
+            ringback_trace_monitor(&tr, 100 + (uint32_t)i, i & 1);
+        }
+        n = ringback_trace_snapshot(&tr, out, 8);
+        /* 写者可能正在覆盖最老的槽位，快照只保留 size - 1 条 */
+        ASSERT(n == 7 && out[0].ms == 113 && out[6].ms == 119, "跟踪：覆盖后只保留最近的记录");
+        n = ringback_trace_snapshot(&tr, out, 3);
+        ASSERT(n == 3 && out[0].ms == 117 && out[2].ms == 119, "跟踪：max 限制时取最近的记录");
+    }
+
+    /* 26. 检测器端到端 - L16/G.711/16kHz 输入走同一条分析链路，判定、停止、监视、RTP 丢包补时 */
+    {
+        static ringback_toneset_t ts;
+        static ringback_detector_t det;
+        static const int busy[] = { 350, 350 }, ringback[] = { 1000, 4000 };
+        static const double f450[] = { 450 };
+        ringback_cadence_rule_t rule;
+        ringback_bank_t bank;
+        ringback_verdict_t v, v2;
+        ringback_detector_frame_t f;
+        int16_t pcm[160];
+        uint64_t rules;
+        uint32_t busy_ms;
+        int r;
+
+        ringback_toneset_init(&ts, ringback_default_freqs, RINGBACK_DEFAULT_NBINS);
+        ringback_cadence_parse(&rule, "busy", RINGBACK_TONE_BUSY, RINGBACK_DEFAULT_BUSY_RULE, 2);
+        ringback_toneset_add_rule(&ts, "default", &rule, f450, 1);
+        ringback_cadence_parse(&rule, "congestion", RINGBACK_TONE_CONGESTION, RINGBACK_DEFAULT_CONGESTION_RULE, 2);
+        ringback_toneset_add_rule(&ts, "default", &rule, f450, 1);
+        ringback_cadence_parse(&rule, "ringback", RINGBACK_TONE_RINGBACK, RINGBACK_DEFAULT_RINGBACK_RULE, 1);
+        ringback_toneset_add_rule(&ts, "default", &rule, f450, 1);
+        ASSERT(ringback_toneset_compile(&ts) == 0, "检测器：编译缺省规则");
+        rules = ringback_toneset_select(&ts, "default");
+        ringback_bank_init(&bank, ringback_default_freqs, RINGBACK_DEFAULT_NBINS, SAMPLE_RATE);
+
+        /* L16 8kHz 忙音：命中 stoptones，检测结束 */
+        ringback_detector_init(&det, &bank, SAMPLE_RATE);
+        ringback_detector_set_rules(&det, rules, RINGBACK_DEFAULT_ENERGY);
+        det.stoptones = RINGBACK_TONE_BUSY;
+        memset(&v, 0, sizeof(v));
+        r = run_detector(&det, &ts, SAMPLE_RATE, RINGBACK_G711_NONE, busy, 2, 6, &v);
+        busy_ms = v.ms;
+        ASSERT(r == RINGBACK_DETECT_STOP && v.tone == RINGBACK_TONE_BUSY && v.stop && v.first &&
+               det.finished && det.decision_ms == v.ms, "检测器：L16 忙音判定并结束");
+        ASSERT(busy_ms >= 1400 && busy_ms <= 1800, "检测器：两个完整周期后判定");
+        ASSERT(!ringback_detector_poll(&det, &v2), "检测器：判定只取出一次");
+        memset(&f, 0, sizeof(f));
+        memset(pcm, 0, sizeof(pcm));
+        f.data = pcm;
+        f.datalen = sizeof(pcm);
+        f.samples = 160;
+        ASSERT(ringback_detector_feed(&det, &ts, &f) == RINGBACK_DETECT_STOP, "检测器：结束后不再分析");
+
+        /* µ-law 原始载荷直接分析，判定时刻与线性输入一致 */
+        ringback_detector_init(&det, &bank, SAMPLE_RATE);
+        ringback_detector_set_rules(&det, rules, RINGBACK_DEFAULT_ENERGY);
+        det.stoptones = RINGBACK_TONE_BUSY;
+        det.g711_law = RINGBACK_G711_ULAW;
+        memset(&v, 0, sizeof(v));
+        r = run_detector(&det, &ts, SAMPLE_RATE, RINGBACK_G711_ULAW, busy, 2, 6, &v);
+        ASSERT(r == RINGBACK_DETECT_STOP && v.tone == RINGBACK_TONE_BUSY && v.ms == busy_ms,
+               "检测器：G.711 忙音判定与 L16 一致");
+
+        /* 16kHz 输入抽取到 8kHz 分析 */
+        ringback_detector_init(&det, &bank, 16000);
+        ringback_detector_set_rules(&det, rules, RINGBACK_DEFAULT_ENERGY);
+        det.stoptones = RINGBACK_TONE_BUSY;
+        memset(&v, 0, sizeof(v));
+        r = run_detector(&det, &ts, 16000, RINGBACK_G711_NONE, busy, 2, 6, &v);
+        ASSERT(det.rate == SAMPLE_RATE && det.decim.factor == 2, "检测器：16kHz 输入多相抽取");
+        ASSERT(r == RINGBACK_DETECT_STOP && v.tone == RINGBACK_TONE_BUSY &&
+               v.ms + 40 >= busy_ms && v.ms <= busy_ms + 40, "检测器：16kHz 忙音判定");
+
+        /* 回铃音不在 stoptones 中：报告判定，检测继续并转入监视 */
+        ringback_detector_init(&det, &bank, SAMPLE_RATE);
+        ringback_detector_set_rules(&det, rules, RINGBACK_DEFAULT_ENERGY);
+        det.stoptones = RINGBACK_TONE_BUSY;
+        det.monitor_interval = 5;
+        memset(&v, 0, sizeof(v));
+        r = run_detector(&det, &ts, SAMPLE_RATE, RINGBACK_G711_NONE, ringback, 2, 3, &v);
+        ASSERT(r == RINGBACK_DETECT_VERDICT && v.tone == RINGBACK_TONE_RINGBACK && !v.stop && !det.finished,
+               "检测器：回铃音判定后继续检测");
+        ASSERT(det.monitor.active && det.tone == RINGBACK_TONE_RINGBACK, "检测器：判定后转入监视");
+
+        /* RTP 序号跳 1：缺失的 20ms 按时间戳补进样本时钟；乱序包不更新基准 */
+        ringback_detector_init(&det, &bank, SAMPLE_RATE);
+        ringback_detector_set_rules(&det, rules, RINGBACK_DEFAULT_ENERGY);
+        f.seq = 1;
+        f.timestamp = 1000;
+        ringback_detector_feed(&det, &ts, &f);
+        f.seq = 3;
+        f.timestamp = 1320;
+        ringback_detector_feed(&det, &ts, &f);
+        ASSERT(ringback_detector_ms(&det) == 60, "检测器：丢包时长计入样本时钟");
+        f.seq = 2;
+        f.timestamp = 1160;
+        ringback_detector_feed(&det, &ts, &f);
+        ASSERT(ringback_detector_ms(&det) == 80 && det.rtp_seq == 3, "检测器：乱序包不重复补时");
+
+        /* 无效采样率：拒绝且不改变配置；未配置采样率的检测器不分析 */
+        ASSERT(ringback_detector_set_rate(&det, 0) < 0 && ringback_detector_set_rate(&det, 40) < 0 &&
+               det.in_rate == SAMPLE_RATE && ringback_detector_ms(&det) == 80, "检测器：拒绝 0 采样率，配置不变");
+        ASSERT(ringback_detector_init(&det, &bank, 0) < 0, "检测器：初始化拒绝 0 采样率");
+        f.seq = 0;
+        f.timestamp = 0;
+        f.rate = 0;
+        ASSERT(ringback_detector_feed(&det, &ts, &f) == RINGBACK_DETECT_CONTINUE && det.stream.samples == 0,
+               "检测器：无有效采样率时不分析");
+
+        /* 超过 60ms 的长帧 (120ms ptime)：分段抽取/解码，整帧计入样本时钟 */
+        {
+            static int16_t wide[1920];
+            static uint8_t ulaw[960];
+            static const struct { int rate, law; } cases[] = {
+                { 16000, RINGBACK_G711_NONE }, { SAMPLE_RATE, RINGBACK_G711_NONE }, { SAMPLE_RATE, RINGBACK_G711_ULAW }
+            };
+            int c, i, k, ok = 1;
+
+            for (i = 0; i < 1920; i++) {
+                wide[i] = (int16_t)(4000 * sin(2 * M_PI * TARGET_FREQ * i / 16000));
+            }
+            memset(ulaw, 0xff, sizeof(ulaw));
+            for (c = 0; c < 3; c++) {
+                ringback_detector_init(&det, &bank, cases[c].rate);
+                ringback_detector_set_rules(&det, rules, RINGBACK_DEFAULT_ENERGY);
+                det.g711_law = cases[c].law;
+                memset(&f, 0, sizeof(f));
+                f.data = cases[c].law != RINGBACK_G711_NONE ? (const void *)ulaw : (const void *)wide;
+                f.samples = (uint32_t)cases[c].rate * 120 / 1000;
+                f.datalen = cases[c].law != RINGBACK_G711_NONE ? f.samples : f.samples * 2;
+                f.rate = (uint32_t)cases[c].rate;
+                for (k = 0; k < 5; k++) {
+                    ringback_detector_feed(&det, &ts, &f);
+                }
+                ok &= ringback_detector_ms(&det) == 600;
+            }
+            ASSERT(ok, "检测器：120ms 帧 (16kHz/L16/G.711) 样本时钟不漂移");
+
+            /* 批处理每轮装不下的长帧改为逐通道计算 */
+            ringback_detector_init(&det, &bank, SAMPLE_RATE);
+            ringback_detector_set_rules(&det, rules, RINGBACK_DEFAULT_ENERGY);
+            det.block_fn = null_block_fn;
+            memset(&f, 0, sizeof(f));
+            f.data = wide;
+            f.samples = 960;
+            f.datalen = 1920;
+            f.rate = SAMPLE_RATE;
+            ringback_detector_feed(&det, &ts, &f);
+            ASSERT(!det.block_fn && ringback_detector_ms(&det) == 120 && null_block_calls == 0,
+                   "检测器：批处理装不下的长帧改为逐通道计算");
+        }
     }
 
     printf("\n=== 结果: %d/%d 通过 ===\n", tests_run - tests_failed, tests_run);